@@ -29,16 +29,68 @@
 #undef main
 #include <glad/glad.h>
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// S3TC (BC1/BC3) is an extension, glad headers generated without it lack these.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <map>
+#include <array>
+#include <tuple>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <cctype>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <filesystem>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <condition_variable>
 #include <fstream>
 #include <sstream>
 #include <iostream>
-#include <unordered_map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define Log(x)\
 std::clog << x << '\n';
@@ -92,6 +144,12 @@ namespace imcgkn
         Triangle_Strip = GL_TRIANGLE_STRIP
     };
 
+    enum class ShaderBuild
+    {
+        Immediate,
+        Deferred
+    };
+
     enum class WrapMode
     {
         ClampToEdge = GL_CLAMP_TO_EDGE,
@@ -127,6 +185,12 @@ namespace imcgkn
         Maximized = SDL_WINDOW_MAXIMIZED | SDL_WINDOW_OPENGL,
     };
 
+    enum class WindowMode
+    {
+        Windowed,
+        Headless
+    };
+
     enum class BufferUsage
     {
         Empty = 0,
@@ -148,6 +212,501 @@ namespace imcgkn
         TextureCubemap = GL_TEXTURE_CUBE_MAP
     };
 
+    enum class FrameMetric
+    {
+        FrameTime,
+        CpuTime,
+        SwapTime
+    };
+
+    /// <summary>
+    /// Frame timings in milliseconds.
+    /// </summary>
+    struct FrameSample
+    {
+        float FrameTime;
+        float CpuTime;
+        float SwapTime;
+    };
+
+    struct FrameTimeSummary
+    {
+        size_t SampleCount = 0;
+        size_t HitchCount = 0;
+        float Min = 0.0f;
+        float Avg = 0.0f;
+        float P50 = 0.0f;
+        float P95 = 0.0f;
+        float P99 = 0.0f;
+        float Max = 0.0f;
+    };
+
+    /// <summary>
+    /// <para>Fixed-size ring buffer of the last FrameStats::Capacity frame samples.</para>
+    /// <para>Lock-free for one writer (render thread) and any number of readers.</para>
+    /// </summary>
+    class FrameStats
+    {
+    public:
+        static constexpr size_t Capacity = 1024;
+
+    private:
+        struct Slot
+        {
+            std::atomic<float> FrameTime{ 0.0f };
+            std::atomic<float> CpuTime{ 0.0f };
+            std::atomic<float> SwapTime{ 0.0f };
+        };
+
+        std::array<Slot, Capacity> m_Slots;
+        std::atomic<uint64_t> m_Started{ 0 };   // Bumped before slot is written
+        std::atomic<uint64_t> m_Written{ 0 };   // Bumped after slot is written
+
+    public:
+        void Record(const FrameSample& sample)
+        {
+            uint64_t index = m_Written.load(std::memory_order_relaxed);
+
+            // Readers see this before any of new values, so slot being rewritten is never taken as complete.
+            m_Started.store(index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            Slot& slot = m_Slots[index % Capacity];
+            slot.FrameTime.store(sample.FrameTime, std::memory_order_relaxed);
+            slot.CpuTime.store(sample.CpuTime, std::memory_order_relaxed);
+            slot.SwapTime.store(sample.SwapTime, std::memory_order_relaxed);
+            m_Written.store(index + 1, std::memory_order_release);
+        }
+
+        void Clear()
+        {
+            m_Started.store(0, std::memory_order_relaxed);
+            m_Written.store(0, std::memory_order_release);
+        }
+
+        /// <returns>Total frames recorded since creation or Clear()</returns>
+        uint64_t GetFrameCount() const
+        {
+            return m_Written.load(std::memory_order_acquire);
+        }
+
+        /// <summary>
+        /// Copies newest samples, oldest first.
+        /// </summary>
+        /// <param name="lastFrames">Size of sliding window (clamped to Capacity)</param>
+        std::vector<FrameSample> GetSamples(size_t lastFrames = Capacity) const
+        {
+            uint64_t written = m_Written.load(std::memory_order_acquire);
+            size_t count = static_cast<size_t>(std::min<uint64_t>(written, std::min(lastFrames, Capacity)));
+
+            std::vector<FrameSample> samples;
+            samples.reserve(count);
+            for (uint64_t i = written - count; i < written; ++i)
+            {
+                const Slot& slot = m_Slots[i % Capacity];
+                samples.push_back({ slot.FrameTime.load(std::memory_order_relaxed),
+                                    slot.CpuTime.load(std::memory_order_relaxed),
+                                    slot.SwapTime.load(std::memory_order_relaxed) });
+            }
+
+            // Drop samples whose slots writer started to overwrite while we were copying, including one still being written.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t started = m_Started.load(std::memory_order_relaxed);
+            uint64_t firstIntact = started > Capacity ? started - Capacity : 0;
+            uint64_t first = written - count;
+            if (firstIntact > first)
+                samples.erase(samples.begin(), samples.begin() + static_cast<size_t>(std::min<uint64_t>(firstIntact - first, samples.size())));
+
+            return samples;
+        }
+
+        /// <param name="metric">Which timing to summarize</param>
+        /// <param name="lastFrames">Size of sliding window (clamped to Capacity)</param>
+        /// <param name="hitchThresholdMs">Frames above this count as hitch. 0 means twice the median.</param>
+        FrameTimeSummary Summarize(FrameMetric metric, size_t lastFrames = Capacity, float hitchThresholdMs = 0.0f) const
+        {
+            std::vector<FrameSample> samples = GetSamples(lastFrames);
+
+            std::vector<float> values;
+            values.reserve(samples.size());
+            for (const FrameSample& sample : samples)
+                values.push_back(GetMetric(sample, metric));
+
+            FrameTimeSummary summary;
+            summary.SampleCount = values.size();
+            if (values.empty())
+                return summary;
+
+            std::sort(values.begin(), values.end());
+
+            double sum = 0.0;
+            for (float v : values)
+                sum += v;
+
+            summary.Min = values.front();
+            summary.Max = values.back();
+            summary.Avg = static_cast<float>(sum / values.size());
+            summary.P50 = Percentile(values, 0.50);
+            summary.P95 = Percentile(values, 0.95);
+            summary.P99 = Percentile(values, 0.99);
+
+            float threshold = hitchThresholdMs > 0.0f ? hitchThresholdMs : summary.P50 * 2.0f;
+            summary.HitchCount = static_cast<size_t>(values.end() - std::upper_bound(values.begin(), values.end(), threshold));
+
+            return summary;
+        }
+
+        /// <summary>
+        /// Writes samples as CSV: frame,frame_ms,cpu_ms,swap_ms
+        /// </summary>
+        void WriteCSV(std::ostream& out, size_t lastFrames = Capacity) const
+        {
+            std::vector<FrameSample> samples = GetSamples(lastFrames);
+
+            out << "frame,frame_ms,cpu_ms,swap_ms\n";
+            for (size_t i = 0; i < samples.size(); ++i)
+                out << i << ',' << samples[i].FrameTime << ',' << samples[i].CpuTime << ',' << samples[i].SwapTime << '\n';
+        }
+
+        /// <summary>
+        /// Writes summary of every metric as JSON object.
+        /// </summary>
+        void WriteJSON(std::ostream& out, size_t lastFrames = Capacity, float hitchThresholdMs = 0.0f) const
+        {
+            const char* names[] = { "frameTime", "cpuTime", "swapTime" };
+            const FrameMetric metrics[] = { FrameMetric::FrameTime, FrameMetric::CpuTime, FrameMetric::SwapTime };
+
+            out << "{\n";
+            for (int i = 0; i < 3; ++i)
+            {
+                FrameTimeSummary s = Summarize(metrics[i], lastFrames, hitchThresholdMs);
+                out << "  \"" << names[i] << "\": { \"samples\": " << s.SampleCount << ", \"hitches\": " << s.HitchCount
+                    << ", \"min\": " << s.Min << ", \"avg\": " << s.Avg << ", \"p50\": " << s.P50
+                    << ", \"p95\": " << s.P95 << ", \"p99\": " << s.P99 << ", \"max\": " << s.Max << " }"
+                    << (i < 2 ? ",\n" : "\n");
+            }
+            out << "}\n";
+        }
+
+    private:
+        static float GetMetric(const FrameSample& sample, FrameMetric metric)
+        {
+            switch (metric)
+            {
+            case FrameMetric::CpuTime:
+                return sample.CpuTime;
+            case FrameMetric::SwapTime:
+                return sample.SwapTime;
+            default:
+                return sample.FrameTime;
+            }
+        }
+
+        // Nearest-rank percentile of sorted values.
+        static float Percentile(const std::vector<float>& sorted, double p)
+        {
+            size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size()) + 0.999999);
+            rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+            return sorted[rank - 1];
+        }
+    };
+
+    /// <summary>
+    /// One input event in recording log. Fields meaning depends on Type (SDL event type).
+    /// </summary>
+    struct InputRecord
+    {
+        uint32_t Type;
+        int32_t A;
+        int32_t B;
+        float X;
+        float Y;
+    };
+
+    /// <summary>
+    /// FNV-1a hash of string. Usable at compile time.
+    /// </summary>
+    constexpr uint32_t HashName(const char* str)
+    {
+        uint32_t hash = 2166136261u;
+        while (*str)
+        {
+            hash ^= static_cast<uint8_t>(*str++);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    /// <summary>
+    /// Checks if current OpenGL context exposes extension.
+    /// </summary>
+    /// <param name="name">Extension name, e.g. "GL_KHR_parallel_shader_compile"</param>
+    inline bool HasGLExtension(const char* name)
+    {
+        int count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (int i = 0; i < count; ++i)
+        {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<unsigned int>(i)));
+            if (extension && std::char_traits<char>::compare(extension, name, std::char_traits<char>::length(name) + 1) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    /// <summary>
+    /// 64-bit FNV-1a hash of bytes. Pass previous result as hash to chain several buffers.
+    /// </summary>
+    inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /// <summary>
+    /// <para>Read-only memory mapping of whole file. Data stays valid until file is closed or MappedFile is destroyed.</para>
+    /// <para>Use it to read shader sources, images or asset packs without copying them through streams.</para>
+    /// <para>Keep mappings short-lived: file truncated by other process while mapped raises SIGBUS on next read.</para>
+    /// </summary>
+    class MappedFile
+    {
+    private:
+        const unsigned char* m_Data = nullptr;
+        size_t m_Size = 0;
+        bool m_Open = false;
+
+#ifdef _WIN32
+        HANDLE m_File = INVALID_HANDLE_VALUE;
+        HANDLE m_Mapping = nullptr;
+#endif
+
+    public:
+        MappedFile() = default;
+
+        explicit MappedFile(const std::string& path)
+        {
+            Open(path);
+        }
+
+        ~MappedFile()
+        {
+            Close();
+        }
+
+        MappedFile(MappedFile&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        MappedFile& operator=(MappedFile&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Close();
+                std::swap(m_Data, other.m_Data);
+                std::swap(m_Size, other.m_Size);
+                std::swap(m_Open, other.m_Open);
+#ifdef _WIN32
+                std::swap(m_File, other.m_File);
+                std::swap(m_Mapping, other.m_Mapping);
+#endif
+            }
+            return *this;
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /// <returns>False if file could not be opened. Empty file opens with null data and size 0.</returns>
+        bool Open(const std::string& path)
+        {
+            Close();
+
+#ifdef _WIN32
+            m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (m_File == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER size{};
+            GetFileSizeEx(m_File, &size);
+            m_Size = static_cast<size_t>(size.QuadPart);
+
+            if (m_Size > 0)
+            {
+                m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (m_Mapping != nullptr)
+                    m_Data = static_cast<const unsigned char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+
+                if (m_Data == nullptr)
+                {
+                    Close();
+                    return false;
+                }
+            }
+#else
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+
+            struct stat status{};
+            if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode))
+            {
+                close(fd);
+                return false;
+            }
+            m_Size = static_cast<size_t>(status.st_size);
+
+            if (m_Size > 0)
+            {
+                void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    close(fd);
+                    m_Size = 0;
+                    return false;
+                }
+                m_Data = static_cast<const unsigned char*>(data);
+            }
+
+            // Mapping keeps file alive, descriptor is not needed anymore.
+            close(fd);
+#endif
+
+            m_Open = true;
+            return true;
+        }
+
+        void Close()
+        {
+#ifdef _WIN32
+            if (m_Data != nullptr)
+                UnmapViewOfFile(m_Data);
+            if (m_Mapping != nullptr)
+                CloseHandle(m_Mapping);
+            if (m_File != INVALID_HANDLE_VALUE)
+                CloseHandle(m_File);
+            m_Mapping = nullptr;
+            m_File = INVALID_HANDLE_VALUE;
+#else
+            if (m_Data != nullptr)
+                munmap(const_cast<unsigned char*>(m_Data), m_Size);
+#endif
+            m_Data = nullptr;
+            m_Size = 0;
+            m_Open = false;
+        }
+
+        bool IsOpen() const
+        {
+            return m_Open;
+        }
+
+        const unsigned char* GetData() const
+        {
+            return m_Data;
+        }
+
+        size_t GetSize() const
+        {
+            return m_Size;
+        }
+
+        /// <returns>Bytes [offset, offset + size) of file, clamped to file size. Use it to address entries of asset pack.</returns>
+        std::string_view GetView(size_t offset = 0, size_t size = std::string_view::npos) const
+        {
+            if (m_Data == nullptr || offset >= m_Size)
+                return {};
+
+            return std::string_view(reinterpret_cast<const char*>(m_Data) + offset, std::min(size, m_Size - offset));
+        }
+    };
+
+    /// <summary>
+    /// <para>Handle of uniform name. Build it once (constexpr UniformID model("model");) and pass it to Shader setters.</para>
+    /// <para>Strings convert implicitly, but then name is hashed on every call.</para>
+    /// </summary>
+    struct UniformID
+    {
+        uint32_t Hash = 0;
+
+        constexpr UniformID() = default;
+
+        constexpr UniformID(const char* name)
+            : Hash(HashName(name))
+        {
+        }
+
+        UniformID(const std::string& name)
+            : Hash(HashName(name.c_str()))
+        {
+        }
+
+        constexpr bool operator==(const UniformID& other) const
+        {
+            return Hash == other.Hash;
+        }
+    };
+
+    /// <summary>
+    /// Binding point of FrameConstants uniform block, shared by all shaders.
+    /// </summary>
+    constexpr unsigned int FrameConstantsBinding = 0;
+
+    /// <summary>
+    /// <para>Per-frame data shared by all shaders through FrameConstants uniform block (std140).</para>
+    /// <para>GLSL: layout(std140) uniform FrameConstants { mat4 projection; mat4 view; mat4 projectionView; vec4 cameraPosition; vec4 time; vec4 viewport; };</para>
+    /// </summary>
+    struct FrameConstants
+    {
+        glm::mat4 Projection = glm::mat4(1.0f);
+        glm::mat4 View = glm::mat4(1.0f);
+        glm::mat4 ProjectionView = glm::mat4(1.0f);
+        glm::vec4 CameraPosition = glm::vec4(0.0f);
+        glm::vec4 Time = glm::vec4(0.0f);       // x = seconds, y = delta time
+        glm::vec4 Viewport = glm::vec4(0.0f);   // x = width, y = height, z = 1 / width, w = 1 / height
+    };
+
+    static_assert(sizeof(FrameConstants) == 3 * 64 + 3 * 16, "FrameConstants must match std140 layout.");
+
+    struct UniformBlockMember
+    {
+        uint32_t Hash = 0;
+        unsigned int Type = 0;
+        int Offset = 0;
+        int Size = 0;           // Array length, 1 for non-arrays
+        int ArrayStride = 0;
+        int MatrixStride = 0;
+        int Bytes = 0;          // Bytes occupied in block
+    };
+
+    /// <summary>
+    /// Layout of uniform block reflected from linked program.
+    /// </summary>
+    struct UniformBlockLayout
+    {
+        std::string Name;
+        uint32_t Hash = 0;
+        unsigned int Index = 0;
+        int DataSize = 0;
+        std::vector<UniformBlockMember> Members;
+
+        /// <returns>Member or nullptr if block has no such member</returns>
+        const UniformBlockMember* FindMember(UniformID name) const
+        {
+            for (const UniformBlockMember& member : Members)
+            {
+                if (member.Hash == name.Hash)
+                    return &member;
+            }
+            return nullptr;
+        }
+    };
+
     inline WindowFlags operator|(WindowFlags a, WindowFlags b)
     {
         return static_cast<WindowFlags>(
@@ -165,10 +724,23 @@ namespace imcgkn
 
         bool m_IsOpen = true;
         bool m_IsResized = false;
+        bool m_IsHeadless = false;
 
         double m_DeltaTime = 0.0;
+        double m_FrameTime = 0.0;
+        double m_FixedDeltaTime = 0.0;
         double m_LastFrame = 0.0;
 
+        FrameStats m_FrameStats;
+
+        static constexpr uint32_t InputLogMagic = 0x52494D49; // "IMIR"
+        static constexpr uint32_t InputLogVersion = 1;
+
+        std::ofstream m_RecordFile;
+        std::ifstream m_ReplayFile;
+        std::streamoff m_ReplayFileSize = 0;
+        std::vector<InputRecord> m_RecordedEvents;
+
         float m_MousePosX = 0.0f;
         float m_MousePosY = 0.0f;
         float m_MouseRelX = 0.0f;
@@ -176,29 +748,55 @@ namespace imcgkn
         float m_ScrollDistance = 0.0f;
         float m_ZoomSpeed = 550.0f;
 
-        std::unordered_map<SDL_Scancode, KeyState> m_Keys;
-        std::unordered_map<uint8_t, KeyState> m_MouseButtons;
+        static constexpr size_t MaxMouseButtons = 8;
+
+        // Dense per-key state. Only entries listed in the dirty lists can hold a
+        // Just* state, so SecondUpdate() never has to walk the whole table.
+        std::array<KeyState, SDL_NUM_SCANCODES> m_Keys;
+        std::array<KeyState, MaxMouseButtons> m_MouseButtons;
+        std::vector<SDL_Scancode> m_DirtyKeys;
+        std::vector<uint8_t> m_DirtyMouseButtons;
 
     public:
-        Window(int w, int h, const std::string& title, int openglMajorVersion = 4, int openglMinorVersion = 5, WindowFlags flags = WindowFlags::Shown | WindowFlags::Resizable)
+        /// <summary>
+        /// <para>Creates window with OpenGL context.</para>
+        /// <para>WindowMode::Headless uses SDL's offscreen video driver (EGL, e.g. Mesa llvmpipe) so the
+        /// same API works on machines without display. Set LIBGL_ALWAYS_SOFTWARE=1 to force llvmpipe.</para>
+        /// </summary>
+        Window(int w, int h, const std::string& title, int openglMajorVersion = 4, int openglMinorVersion = 5, WindowFlags flags = WindowFlags::Shown | WindowFlags::Resizable, WindowMode mode = WindowMode::Windowed)
         {
             m_Width = w;
             m_Height = h;
+            m_IsHeadless = mode == WindowMode::Headless;
+
+            uint32_t subsystems = SDL_INIT_EVERYTHING;
+            if (m_IsHeadless)
+            {
+                // Audio, joystick and haptic usually fail to initialize on build machines.
+                SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+                subsystems = SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_EVENTS;
+                flags = WindowFlags::Hidden;
+            }
 
-            if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
-                Error("Failed to initialize SDL2.");
+            if (SDL_Init(subsystems) < 0)
+                Error("Failed to initialize SDL2. " << SDL_GetError());
 
             SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, openglMajorVersion);
             SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, openglMinorVersion);
             SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
             window = SDL_CreateWindow(title.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, m_Width, m_Height, (uint32_t)flags);
             if (!window)
-                Error("Failed to create SDL_window.");
+                Error("Failed to create SDL_window. " << SDL_GetError());
 
             glContext = SDL_GL_CreateContext(window);
+            if (!glContext)
+                Error("Failed to create OpenGL context. " << SDL_GetError());
 
             SDL_GL_MakeCurrent(window, glContext);
 
+            if (m_IsHeadless)
+                SDL_GL_SetSwapInterval(0);
+
             if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress))
             {
                 Error("Failed to load GLAD!");
@@ -209,11 +807,11 @@ namespace imcgkn
 
             m_LastFrame = (double)SDL_GetPerformanceCounter();
 
-            for (int i = 0; i < SDL_NUM_SCANCODES; ++i)
-                m_Keys[static_cast<SDL_Scancode>(i)] = KeyState::Released;
+            m_Keys.fill(KeyState::Released);
+            m_MouseButtons.fill(KeyState::Released);
 
-            for (int i = 0; i < 5; ++i)
-                m_MouseButtons[i] = KeyState::Released;
+            m_DirtyKeys.reserve(32);
+            m_DirtyMouseButtons.reserve(MaxMouseButtons);
         }
 
         ~Window()
@@ -229,60 +827,45 @@ namespace imcgkn
         void UpdateDeltaTime()
         {
             double newFrame = (double)SDL_GetPerformanceCounter();
-            m_DeltaTime = ((newFrame - m_LastFrame) / (double)SDL_GetPerformanceFrequency());
+            m_FrameTime = ((newFrame - m_LastFrame) / (double)SDL_GetPerformanceFrequency());
+            m_DeltaTime = m_FrameTime;
             m_LastFrame = newFrame;
         }
 
         /// <summary>
         /// <para>Updates deltaTime and polls events. </para>
+        /// <para>While replaying, events and deltaTime come from input log instead of SDL.</para>
         /// <para>ALL FUNCTIONS FOR THIS CLASS MUST BE INBETWEEN [ FirstUpdate(), SecondUpdate() ] FUNCTIONS!</para>
         /// </summary>
         void FirstUpdate()
         {
             SDL_Event ev;
 
-            while (SDL_PollEvent(&ev))
+            if (m_ReplayFile.is_open())
             {
-                switch (ev.type)
+                // Only quit is taken from SDL while replaying, everything else comes from log.
+                while (SDL_PollEvent(&ev))
                 {
-                case SDL_QUIT:
-                    m_IsOpen = false;
-                    break;
-                case SDL_KEYDOWN:
-                    m_Keys[ev.key.keysym.scancode] = KeyState::JustPressed;
-                    break;
-                case SDL_KEYUP:
-                    m_Keys[ev.key.keysym.scancode] = KeyState::JustReleased;
-                    break;
-                case SDL_MOUSEBUTTONDOWN:
-                    m_MouseButtons[ev.button.button] = KeyState::JustPressed;
-                    break;
-                case SDL_MOUSEBUTTONUP:
-                    m_MouseButtons[ev.button.button] = KeyState::JustReleased;
-                    break;
-                case SDL_WINDOWEVENT:
-                    if (ev.window.event == SDL_WINDOWEVENT_RESIZED)
-                    {
-                        m_Width = ev.window.data1;
-                        m_Height = ev.window.data2;
-                        glViewport(0, 0, m_Width, m_Height);
-                        m_IsResized = true;
-                    }
-                    break;
-                case SDL_MOUSEMOTION:
-                    m_MouseRelX = static_cast<float>(ev.motion.xrel);
-                    m_MouseRelY = static_cast<float>(ev.motion.yrel);
-                    m_MousePosX = static_cast<float>(ev.motion.x);
-                    m_MousePosY = static_cast<float>(ev.motion.y);
-                    break;
-                case SDL_MOUSEWHEEL:
-                    if (ev.wheel.preciseY > 0)
-                        m_ScrollDistance -= m_ZoomSpeed * static_cast<float>(m_DeltaTime);
-                    else if (ev.wheel.preciseY < 0)
-                        m_ScrollDistance += m_ZoomSpeed * static_cast<float>(m_DeltaTime);
-                    break;
+                    if (ev.type == SDL_QUIT)
+                        m_IsOpen = false;
                 }
+
+                ReplayFrame();
+                return;
+            }
+
+            m_RecordedEvents.clear();
+
+            while (SDL_PollEvent(&ev))
+            {
+                if (m_RecordFile.is_open())
+                    RecordEvent(ev);
+
+                HandleEvent(ev);
             }
+
+            if (m_RecordFile.is_open())
+                WriteRecordedFrame();
         }
 
         /// <summary>
@@ -291,21 +874,14 @@ namespace imcgkn
         /// </summary>
         void SecondUpdate()
         {
-            for (auto& key : m_Keys)
-            {
-                if (key.second == KeyState::JustPressed)
-                    key.second = KeyState::Down;
-                if (key.second == KeyState::JustReleased)
-                    key.second = KeyState::Released;
-            }
+            for (SDL_Scancode key : m_DirtyKeys)
+                m_Keys[key] = SettleKeyState(m_Keys[key]);
 
-            for (auto& mouseButton : m_MouseButtons)
-            {
-                if (mouseButton.second == KeyState::JustPressed)
-                    mouseButton.second = KeyState::Down;
-                if (mouseButton.second == KeyState::JustReleased)
-                    mouseButton.second = KeyState::Released;
-            }
+            for (uint8_t mouseButton : m_DirtyMouseButtons)
+                m_MouseButtons[mouseButton] = SettleKeyState(m_MouseButtons[mouseButton]);
+
+            m_DirtyKeys.clear();
+            m_DirtyMouseButtons.clear();
 
             m_IsResized = false;
             m_MouseRelX = 0.0f;
@@ -313,11 +889,19 @@ namespace imcgkn
         }
 
         /// <summary>
-        /// Swaps OpenGL buffer. Call it after all rendering is done!
+        /// <para>Swaps OpenGL buffer. Call it after all rendering is done!</para>
+        /// <para>Also records frame, CPU (UpdateDeltaTime() to swap) and swap time into GetFrameStats().</para>
         /// </summary>
         void SwapBuffer()
         {
+            double swapStart = (double)SDL_GetPerformanceCounter();
             SDL_GL_SwapWindow(window);
+            double swapEnd = (double)SDL_GetPerformanceCounter();
+
+            double toMs = 1000.0 / (double)SDL_GetPerformanceFrequency();
+            m_FrameStats.Record({ static_cast<float>(m_FrameTime * 1000.0),
+                                  static_cast<float>((swapStart - m_LastFrame) * toMs),
+                                  static_cast<float>((swapEnd - swapStart) * toMs) });
         }
 
         void ClearScreen(unsigned int bitField, float r = 0.05f, float g = 0.05f, float b = 0.05f, float a = 1.0f)
@@ -375,6 +959,15 @@ namespace imcgkn
             return m_IsOpen == true;
         }
 
+        /// <summary>
+        /// Checks if window was created with WindowMode::Headless.
+        /// </summary>
+        /// <returns>True or false</returns>
+        bool IsHeadless() const
+        {
+            return m_IsHeadless;
+        }
+
         /// <summary>
         /// Checks if window was resized.
         /// </summary>
@@ -389,9 +982,9 @@ namespace imcgkn
         /// </summary>
         /// <param name="key">Scancode for key</param>
         /// <returns>True or false</returns>
-        bool CheckKeyUp(SDL_Scancode key)
+        bool CheckKeyUp(SDL_Scancode key) const
         {
-            return m_Keys[key] == KeyState::JustReleased;
+            return static_cast<size_t>(key) < m_Keys.size() && m_Keys[key] == KeyState::JustReleased;
         }
 
         /// <summary>
@@ -399,9 +992,9 @@ namespace imcgkn
         /// </summary>
         /// <param name="key">Scancode for key</param>
         /// <returns>True or false</returns>
-        bool CheckKeyDown(SDL_Scancode key)
+        bool CheckKeyDown(SDL_Scancode key) const
         {
-            return m_Keys[key] == KeyState::Down;
+            return static_cast<size_t>(key) < m_Keys.size() && m_Keys[key] == KeyState::Down;
         }
 
         /// <summary>
@@ -409,9 +1002,9 @@ namespace imcgkn
         /// </summary>
         /// <param name="key">Scancode for key</param>
         /// <returns>True or false</returns>
-        bool CheckMouseButtonUp(uint8_t key)
+        bool CheckMouseButtonUp(uint8_t key) const
         {
-            return m_MouseButtons[key] == KeyState::JustReleased;
+            return key < MaxMouseButtons && m_MouseButtons[key] == KeyState::JustReleased;
         }
 
         /// <summary>
@@ -419,9 +1012,9 @@ namespace imcgkn
         /// </summary>
         /// <param name="key">Scancode for key</param>
         /// <returns>True or false</returns>
-        bool CheckMouseButtonDown(uint8_t key)
+        bool CheckMouseButtonDown(uint8_t key) const
         {
-            return m_MouseButtons[key] == KeyState::Down;
+            return key < MaxMouseButtons && m_MouseButtons[key] == KeyState::Down;
         }
 
         float GetDeltaTime() const
@@ -429,30 +1022,668 @@ namespace imcgkn
             return static_cast<float>(m_DeltaTime);
         }
 
-        float GetScrollDistance() const
+        /// <summary>
+        /// <para>Sets simulation step used by scroll zoom instead of frame delta time.</para>
+        /// <para>FixedTimestep::Advance(Window&amp;) sets this for you. 0 means use frame delta time.</para>
+        /// </summary>
+        /// <param name="v">step in seconds</param>
+        void SetFixedDeltaTime(double v)
         {
-            return static_cast<float>(m_ScrollDistance);
+            m_FixedDeltaTime = v;
         }
 
-        /// <returns>viewport width</returns>
-        int GetWidth() const
+        /// <summary>
+        /// <para>Starts writing every frame's deltaTime and input events into binary log.</para>
+        /// <para>Start recording and replay at the same point of your program (e.g. right after creating window).</para>
+        /// </summary>
+        /// <param name="path">Path to log file</param>
+        /// <returns>True if file was opened</returns>
+        bool StartRecording(const std::string& path)
         {
-            return m_Width;
+            StopReplay();
+            m_RecordFile.close();
+            m_RecordFile.open(path, std::ios::binary | std::ios::trunc);
+            if (!m_RecordFile.is_open())
+            {
+                Log("Warning! << Failed to open input log for recording: " << path);
+                return false;
+            }
+
+            m_RecordFile.write(reinterpret_cast<const char*>(&InputLogMagic), sizeof(InputLogMagic));
+            m_RecordFile.write(reinterpret_cast<const char*>(&InputLogVersion), sizeof(InputLogVersion));
+            return true;
         }
 
-        /// <returns>viewport height</returns>
-        int GetHeight() const
+        void StopRecording()
         {
-            return m_Height;
+            m_RecordFile.close();
         }
-    };
+
+        /// <summary>
+        /// <para>Feeds input log back instead of SDL events, frame by frame, including recorded deltaTime.</para>
+        /// <para>Window closes itself when log ends.</para>
+        /// </summary>
+        /// <param name="path">Path to log made by StartRecording()</param>
+        /// <returns>True if file was opened and is valid input log</returns>
+        bool StartReplay(const std::string& path)
+        {
+            StopRecording();
+            m_ReplayFile.close();
+            m_ReplayFile.open(path, std::ios::binary);
+            if (!m_ReplayFile.is_open())
+            {
+                Log("Warning! << Failed to open input log for replay: " << path);
+                return false;
+            }
+
+            m_ReplayFile.seekg(0, std::ios::end);
+            m_ReplayFileSize = m_ReplayFile.tellg();
+            m_ReplayFile.seekg(0, std::ios::beg);
+
+            uint32_t magic = 0, version = 0;
+            m_ReplayFile.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+            m_ReplayFile.read(reinterpret_cast<char*>(&version), sizeof(version));
+            if (!m_ReplayFile || magic != InputLogMagic || version != InputLogVersion)
+            {
+                Log("Warning! << Not a valid input log: " << path);
+                m_ReplayFile.close();
+                return false;
+            }
+            return true;
+        }
+
+        void StopReplay()
+        {
+            m_ReplayFile.close();
+        }
+
+        bool IsRecording() const
+        {
+            return m_RecordFile.is_open();
+        }
+
+        bool IsReplaying() const
+        {
+            return m_ReplayFile.is_open();
+        }
+
+        /// <returns>Ring buffer with timings of recent frames</returns>
+        const FrameStats& GetFrameStats() const
+        {
+            return m_FrameStats;
+        }
+
+        float GetScrollDistance() const
+        {
+            return static_cast<float>(m_ScrollDistance);
+        }
+
+        /// <returns>viewport width</returns>
+        int GetWidth() const
+        {
+            return m_Width;
+        }
+
+        /// <returns>viewport height</returns>
+        int GetHeight() const
+        {
+            return m_Height;
+        }
+
+    private:
+        void HandleEvent(const SDL_Event& ev)
+        {
+            switch (ev.type)
+            {
+            case SDL_QUIT:
+                m_IsOpen = false;
+                break;
+            case SDL_KEYDOWN:
+                SetKeyState(ev.key.keysym.scancode, KeyState::JustPressed);
+                break;
+            case SDL_KEYUP:
+                SetKeyState(ev.key.keysym.scancode, KeyState::JustReleased);
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+                SetMouseButtonState(ev.button.button, KeyState::JustPressed);
+                break;
+            case SDL_MOUSEBUTTONUP:
+                SetMouseButtonState(ev.button.button, KeyState::JustReleased);
+                break;
+            case SDL_WINDOWEVENT:
+                if (ev.window.event == SDL_WINDOWEVENT_RESIZED)
+                {
+                    m_Width = ev.window.data1;
+                    m_Height = ev.window.data2;
+                    glViewport(0, 0, m_Width, m_Height);
+                    m_IsResized = true;
+                }
+                break;
+            case SDL_MOUSEMOTION:
+                m_MouseRelX = static_cast<float>(ev.motion.xrel);
+                m_MouseRelY = static_cast<float>(ev.motion.yrel);
+                m_MousePosX = static_cast<float>(ev.motion.x);
+                m_MousePosY = static_cast<float>(ev.motion.y);
+                break;
+            case SDL_MOUSEWHEEL:
+                if (ev.wheel.preciseY > 0)
+                    m_ScrollDistance -= m_ZoomSpeed * static_cast<float>(GetStepDeltaTime());
+                else if (ev.wheel.preciseY < 0)
+                    m_ScrollDistance += m_ZoomSpeed * static_cast<float>(GetStepDeltaTime());
+                break;
+            }
+        }
+
+        void RecordEvent(const SDL_Event& ev)
+        {
+            InputRecord record = { ev.type, 0, 0, 0.0f, 0.0f };
+
+            switch (ev.type)
+            {
+            case SDL_QUIT:
+                break;
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                record.A = ev.key.keysym.scancode;
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+                record.A = ev.button.button;
+                break;
+            case SDL_WINDOWEVENT:
+                if (ev.window.event != SDL_WINDOWEVENT_RESIZED)
+                    return;
+                record.A = ev.window.data1;
+                record.B = ev.window.data2;
+                break;
+            case SDL_MOUSEMOTION:
+                record.A = ev.motion.xrel;
+                record.B = ev.motion.yrel;
+                record.X = static_cast<float>(ev.motion.x);
+                record.Y = static_cast<float>(ev.motion.y);
+                break;
+            case SDL_MOUSEWHEEL:
+                record.X = ev.wheel.preciseX;
+                record.Y = ev.wheel.preciseY;
+                break;
+            default:
+                return;
+            }
+
+            m_RecordedEvents.push_back(record);
+        }
+
+        void WriteRecordedFrame()
+        {
+            uint32_t count = static_cast<uint32_t>(m_RecordedEvents.size());
+            m_RecordFile.write(reinterpret_cast<const char*>(&m_DeltaTime), sizeof(m_DeltaTime));
+            m_RecordFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            m_RecordFile.write(reinterpret_cast<const char*>(m_RecordedEvents.data()), count * sizeof(InputRecord));
+        }
+
+        void ReplayFrame()
+        {
+            double deltaTime = 0.0;
+            uint32_t count = 0;
+            m_ReplayFile.read(reinterpret_cast<char*>(&deltaTime), sizeof(deltaTime));
+            m_ReplayFile.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+            // Count comes from file, never allocate more than rest of file can hold (truncated or corrupt log).
+            std::streamoff remaining = m_ReplayFile ? m_ReplayFileSize - m_ReplayFile.tellg() : 0;
+            if (m_ReplayFile && static_cast<uint64_t>(count) * sizeof(InputRecord) > static_cast<uint64_t>(std::max<std::streamoff>(remaining, 0)))
+            {
+                Log("Warning! << Input log is truncated or corrupt, stopping replay.");
+                m_ReplayFile.close();
+                m_IsOpen = false;
+                return;
+            }
+
+            if (m_ReplayFile)
+            {
+                m_RecordedEvents.resize(count);
+                if (count > 0)
+                    m_ReplayFile.read(reinterpret_cast<char*>(m_RecordedEvents.data()), count * sizeof(InputRecord));
+            }
+
+            if (!m_ReplayFile)
+            {
+                Log("Info! << Input replay finished.");
+                m_ReplayFile.close();
+                m_IsOpen = false;
+                return;
+            }
+
+            m_DeltaTime = deltaTime;
+
+            for (const InputRecord& record : m_RecordedEvents)
+            {
+                SDL_Event ev = {};
+                ev.type = record.Type;
+
+                switch (record.Type)
+                {
+                case SDL_KEYDOWN:
+                case SDL_KEYUP:
+                    ev.key.keysym.scancode = static_cast<SDL_Scancode>(record.A);
+                    break;
+                case SDL_MOUSEBUTTONDOWN:
+                case SDL_MOUSEBUTTONUP:
+                    ev.button.button = static_cast<uint8_t>(record.A);
+                    break;
+                case SDL_WINDOWEVENT:
+                    ev.window.event = SDL_WINDOWEVENT_RESIZED;
+                    ev.window.data1 = record.A;
+                    ev.window.data2 = record.B;
+                    break;
+                case SDL_MOUSEMOTION:
+                    ev.motion.xrel = record.A;
+                    ev.motion.yrel = record.B;
+                    ev.motion.x = static_cast<int32_t>(record.X);
+                    ev.motion.y = static_cast<int32_t>(record.Y);
+                    break;
+                case SDL_MOUSEWHEEL:
+                    ev.wheel.preciseX = record.X;
+                    ev.wheel.preciseY = record.Y;
+                    break;
+                }
+
+                HandleEvent(ev);
+            }
+        }
+
+        double GetStepDeltaTime() const
+        {
+            return m_FixedDeltaTime > 0.0 ? m_FixedDeltaTime : m_DeltaTime;
+        }
+
+        void SetKeyState(SDL_Scancode key, KeyState state)
+        {
+            if (static_cast<size_t>(key) >= m_Keys.size())
+                return;
+
+            m_Keys[key] = state;
+            m_DirtyKeys.push_back(key);
+        }
+
+        void SetMouseButtonState(uint8_t button, KeyState state)
+        {
+            if (button >= MaxMouseButtons)
+                return;
+
+            m_MouseButtons[button] = state;
+            m_DirtyMouseButtons.push_back(button);
+        }
+
+        static KeyState SettleKeyState(KeyState state)
+        {
+            if (state == KeyState::JustPressed)
+                return KeyState::Down;
+            if (state == KeyState::JustReleased)
+                return KeyState::Released;
+            return state;
+        }
+    };
+
+    /// <summary>
+    /// <para>Fixed-rate simulation driver. Accumulates frame time and hands out fixed steps.</para>
+    /// <para>Usage: Advance(window); while (Step()) { Update(window, GetStepTime()); } then render with GetAlpha().</para>
+    /// </summary>
+    class FixedTimestep
+    {
+    private:
+        double m_Step = 1.0 / 60.0;
+        double m_Accumulator = 0.0;
+
+        int m_MaxStepsPerFrame = 5;
+        int m_StepsThisFrame = 0;
+
+        size_t m_ClampedFrames = 0;
+
+    public:
+        /// <param name="updateRate">Simulation updates per second</param>
+        /// <param name="maxStepsPerFrame">Spiral-of-death guard. Frame time above this many steps is dropped.</param>
+        FixedTimestep(double updateRate = 60.0, int maxStepsPerFrame = 5)
+            : m_Step(1.0 / updateRate), m_MaxStepsPerFrame(maxStepsPerFrame)
+        {
+            if (updateRate <= 0.0 || maxStepsPerFrame <= 0)
+                Error("FixedTimestep needs positive update rate and max steps per frame.");
+        }
+
+        /// <summary>
+        /// Adds frame time to accumulator. Call once per frame, before Step() loop.
+        /// </summary>
+        /// <param name="frameTime">frame time in seconds</param>
+        void Advance(double frameTime)
+        {
+            m_StepsThisFrame = 0;
+
+            if (frameTime > 0.0)
+                m_Accumulator += frameTime;
+
+            double maxAccumulated = m_Step * m_MaxStepsPerFrame;
+            if (m_Accumulator > maxAccumulated)
+            {
+                m_Accumulator = maxAccumulated;
+                ++m_ClampedFrames;
+            }
+        }
+
+        /// <summary>
+        /// Adds window delta time to accumulator and makes window use fixed step for scroll zoom.
+        /// </summary>
+        void Advance(Window& window)
+        {
+            window.SetFixedDeltaTime(m_Step);
+            Advance(static_cast<double>(window.GetDeltaTime()));
+        }
+
+        /// <summary>
+        /// Consumes one fixed step from accumulator.
+        /// </summary>
+        /// <returns>True while there is simulation step to run this frame</returns>
+        bool Step()
+        {
+            if (m_StepsThisFrame >= m_MaxStepsPerFrame || m_Accumulator < m_Step)
+                return false;
+
+            m_Accumulator -= m_Step;
+            ++m_StepsThisFrame;
+            return true;
+        }
+
+        /// <returns>Interpolation factor [0, 1] between previous and current simulation state</returns>
+        float GetAlpha() const
+        {
+            return static_cast<float>(m_Accumulator / m_Step);
+        }
+
+        /// <returns>Fixed step in seconds</returns>
+        float GetStepTime() const
+        {
+            return static_cast<float>(m_Step);
+        }
+
+        int GetStepsThisFrame() const
+        {
+            return m_StepsThisFrame;
+        }
+
+        /// <returns>How many frames hit max steps and dropped simulation time</returns>
+        size_t GetClampedFrameCount() const
+        {
+            return m_ClampedFrames;
+        }
+    };
+
+    /// <summary>
+    /// <para>Process-wide cache of shader source files. Each file is read once, no matter how many shaders include it.</para>
+    /// <para>Thread safe. ShaderHotReloader invalidates entries of changed files, entries whose size or write time changed are reloaded too.</para>
+    /// <para>Contents are copied out of short-lived mapping, so editors can save files in place while they are cached.</para>
+    /// </summary>
+    class ShaderSourceCache
+    {
+    public:
+        struct File
+        {
+            std::string Path;
+            std::string Contents;
+            bool Exists = false;
+
+            uintmax_t Size = 0;
+            std::filesystem::file_time_type WriteTime{};
+        };
+
+    private:
+        static inline std::mutex s_Mutex;
+        static inline std::map<std::string, std::shared_ptr<const File>> s_Files;
+
+    public:
+        /// <returns>Absolute, normalized path used as cache key</returns>
+        static std::string NormalizePath(const std::string& path)
+        {
+            return std::filesystem::absolute(path).lexically_normal().string();
+        }
+
+        static std::shared_ptr<const File> Get(const std::string& path)
+        {
+            std::string key = NormalizePath(path);
+
+            {
+                std::lock_guard<std::mutex> lock(s_Mutex);
+                auto fileIter = s_Files.find(key);
+                if (fileIter != s_Files.end() && IsCurrent(*fileIter->second))
+                    return fileIter->second;
+            }
+
+            std::shared_ptr<File> file = std::make_shared<File>();
+            file->Path = key;
+
+            std::error_code error;
+            file->Size = std::filesystem::file_size(key, error);
+            file->WriteTime = std::filesystem::last_write_time(key, error);
+
+            {
+                MappedFile mapping;
+                if (mapping.Open(key))
+                {
+                    file->Contents = std::string(mapping.GetView());
+                    file->Exists = true;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(s_Mutex);
+            s_Files[key] = file;
+            return file;
+        }
+
+        static void Invalidate(const std::string& path)
+        {
+            std::lock_guard<std::mutex> lock(s_Mutex);
+            s_Files.erase(NormalizePath(path));
+        }
+
+        static void Clear()
+        {
+            std::lock_guard<std::mutex> lock(s_Mutex);
+            s_Files.clear();
+        }
+
+    private:
+        static bool IsCurrent(const File& file)
+        {
+            std::error_code error;
+            uintmax_t size = std::filesystem::file_size(file.Path, error);
+            if (error)
+                return !file.Exists;
+
+            return file.Exists && size == file.Size && std::filesystem::last_write_time(file.Path, error) == file.WriteTime;
+        }
+    };
+
+    struct PreprocessedShader
+    {
+        std::string Source;
+        std::vector<std::string> Dependencies;  // Normalized paths of files this stage used
+    };
+
+    /// <summary>
+    /// <para>Resolves #include "file" relative to including file, honours #pragma once and reports every file used.</para>
+    /// <para>Inserts #line directives so compiler errors point to right file. Source number is index in sourceFiles, which
+    /// can be shared by all stages of program (Shader::GetSourceFiles()), or in Dependencies when sourceFiles is null.</para>
+    /// </summary>
+    class ShaderPreprocessor
+    {
+    private:
+        static constexpr int MaxIncludeDepth = 32;
+
+    public:
+        /// <param name="sourceFiles">Numbering shared across calls, new files are appended. Null = number by Dependencies.</param>
+        static PreprocessedShader Process(const std::string& path, std::vector<std::string>* sourceFiles = nullptr)
+        {
+            PreprocessedShader result;
+            std::vector<std::string> onceFiles, stack;
+            Expand(path, result, sourceFiles != nullptr ? *sourceFiles : result.Dependencies, onceFiles, stack);
+            return result;
+        }
+
+    private:
+        static bool Expand(const std::string& path, PreprocessedShader& result, std::vector<std::string>& sourceFiles, std::vector<std::string>& onceFiles, std::vector<std::string>& stack)
+        {
+            std::shared_ptr<const ShaderSourceCache::File> file = ShaderSourceCache::Get(path);
+
+            auto sourceFile = std::find(sourceFiles.begin(), sourceFiles.end(), file->Path);
+            int fileIndex = static_cast<int>(sourceFile - sourceFiles.begin());
+            if (sourceFile == sourceFiles.end())
+                sourceFiles.push_back(file->Path);
+
+            if (&sourceFiles != &result.Dependencies && std::find(result.Dependencies.begin(), result.Dependencies.end(), file->Path) == result.Dependencies.end())
+                result.Dependencies.push_back(file->Path);
+
+            if (!file->Exists)
+            {
+                Log("Warning! << Failed to open file from path: " << path);
+                return false;
+            }
+
+            if (std::find(onceFiles.begin(), onceFiles.end(), file->Path) != onceFiles.end())
+                return true;
+
+            if (stack.size() >= MaxIncludeDepth || std::find(stack.begin(), stack.end(), file->Path) != stack.end())
+            {
+                Log("Warning! << Recursive #include of " << file->Path);
+                return false;
+            }
+
+            std::string_view contents = file->Contents;
+
+            // Root file must keep #version as its first line, so its number (when not 0) is set right after it.
+            bool numberAfterVersion = stack.empty() && fileIndex != 0 && contents.find("#version") != std::string_view::npos;
+            if (!stack.empty() || (fileIndex != 0 && !numberAfterVersion))
+                result.Source += "#line 1 " + std::to_string(fileIndex) + "\n";
+
+            stack.push_back(file->Path);
+
+            std::filesystem::path directory = std::filesystem::path(file->Path).parent_path();
+            int lineNumber = 0;
+
+            for (size_t pos = 0; pos < contents.size(); )
+            {
+                size_t lineEnd = contents.find('\n', pos);
+                if (lineEnd == std::string_view::npos)
+                    lineEnd = contents.size();
+
+                std::string_view line = contents.substr(pos, lineEnd - pos);
+                pos = lineEnd + 1;
+                ++lineNumber;
+
+                size_t first = line.find_first_not_of(" \t");
+                if (first != std::string_view::npos && line.compare(first, 12, "#pragma once") == 0)
+                {
+                    onceFiles.push_back(file->Path);
+                    result.Source += '\n';
+                }
+                else if (first != std::string_view::npos && line.compare(first, 8, "#include") == 0)
+                {
+                    size_t open = line.find_first_of("\"<", first + 8);
+                    size_t close = open == std::string_view::npos ? std::string_view::npos : line.find_first_of("\">", open + 1);
+                    if (close == std::string_view::npos)
+                    {
+                        Log("Warning! << Malformed #include in " << file->Path << ":" << lineNumber);
+                        result.Source += '\n';
+                        continue;
+                    }
+
+                    std::string included = (directory / line.substr(open + 1, close - open - 1)).string();
+                    Expand(included, result, sourceFiles, onceFiles, stack);
+                    result.Source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+                }
+                else
+                {
+                    result.Source += line;
+                    result.Source += '\n';
+
+                    if (numberAfterVersion && first != std::string_view::npos && line.compare(first, 8, "#version") == 0)
+                    {
+                        result.Source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+                        numberAfterVersion = false;
+                    }
+                }
+            }
+
+            stack.pop_back();
+            return true;
+        }
+    };
+
+    /// <summary>
+    /// Preprocessor defines injected into shader sources. Each entry is "NAME" or "NAME VALUE".
+    /// </summary>
+    using ShaderDefines = std::vector<std::string>;
 
     class Shader
     {
+        friend class ShaderHotReloader;
+        friend class ShaderVariants;
+
     private:
         unsigned int m_ID = 0;
 
-        std::map<std::string, int> m_UniformLocations;
+        // Vertex, fragment and geometry source paths.
+        std::string m_Paths[3];
+        ShaderDefines m_Defines;
+
+        // Every file used by this shader, including #include'd ones.
+        std::vector<std::string> m_Dependencies;
+
+        // Program currently bound with glUseProgram, shared by all shaders (one GL context).
+        static inline unsigned int s_BoundProgram = 0;
+
+        // Directory for linked program binaries. Empty disables cache.
+        static inline std::string s_BinaryCacheDirectory;
+        static constexpr uint32_t ProgramBinaryMagic = 0x42504D49; // "IMPB"
+
+        // -1 unknown, 0 no, 1 GL_KHR/ARB_parallel_shader_compile available.
+        static inline int s_ParallelCompile = -1;
+
+        // Program whose compile/link was submitted but not checked yet.
+        struct ProgramBuild
+        {
+            unsigned int Program = 0;
+            unsigned int Stages[3] = { 0, 0, 0 };
+            std::string CachePath;
+            bool FromCache = false;
+        };
+
+        ProgramBuild m_Build;
+        bool m_Ready = false;
+        bool m_WarnedNotReady = false;  // Setter was called before deferred build finished
+
+        ProgramBuild m_ReloadBuild;
+        bool m_Reloading = false;
+
+        struct UniformSlot
+        {
+            uint32_t Hash;
+            int Location;
+            size_t Shadow;  // Index into m_UniformShadows, shared by "name" and "name[0]"
+        };
+
+        // Last value uploaded to uniform, setters skip GL call when new value is bitwise same.
+        struct UniformShadow
+        {
+            unsigned char Bytes[sizeof(glm::mat4)];
+            size_t Size = 0;  // 0 = unknown value
+        };
+
+        // Active uniforms reflected after link, sorted by name hash.
+        std::vector<UniformSlot> m_Uniforms;
+        std::vector<UniformShadow> m_UniformShadows;
+
+        static inline uint64_t s_UniformUploads = 0;
+        static inline uint64_t s_UniformUploadsElided = 0;
+
+        std::vector<UniformBlockLayout> m_UniformBlocks;
+        std::map<uint32_t, unsigned int> m_UniformBlockBindings;
 
         enum class ShaderType
         {
@@ -468,531 +1699,4147 @@ namespace imcgkn
         /// <param name="vertexShaderPath">Path to vertex shader</param>
         /// <param name="fragmentShaderPath">Path to fragment shader</param>
         /// <param name="geometryShaderPath">Path to geometry shader(Can be empty)</param>
-        Shader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath = "")
+        /// <param name="build">
+        /// <para>ShaderBuild::Deferred submits compile and link without waiting for them.</para>
+        /// <para>Poll IsReady() later, with GL_KHR_parallel_shader_compile driver compiles on its own threads meanwhile.</para>
+        /// <para>Uniforms are unknown until then, setters drop their values (first one logs warning). Set them after IsReady().</para>
+        /// </param>
+        /// <param name="defines">Defines inserted after #version line of every stage (see ShaderVariants)</param>
+        Shader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath = "", ShaderBuild build = ShaderBuild::Immediate, const ShaderDefines& defines = {})
+            : m_Paths{ vertexShaderPath, fragmentShaderPath, geometryShaderPath }, m_Defines(NormalizeDefines(defines))
         {
-            unsigned int vertex = 0, fragment = 0, geometry = 0;
-            std::string vertexStringSource = GetShaderSource(vertexShaderPath);
-            std::string fragmentStringSource = GetShaderSource(fragmentShaderPath);
-            std::string geometryStringSource = GetShaderSource(geometryShaderPath);
+            std::string vertexSource = GetShaderSource(vertexShaderPath, m_Defines, &m_Dependencies);
+            std::string fragmentSource = GetShaderSource(fragmentShaderPath, m_Defines, &m_Dependencies);
+            std::string geometrySource = GetShaderSource(geometryShaderPath, m_Defines, &m_Dependencies);
 
-            const char* vShaderSource = vertexStringSource.c_str();
-            const char* fShaderSource = fragmentStringSource.c_str();
-            const char* gShaderSource = geometryStringSource.c_str();
+            m_Build = SubmitProgram(vertexSource, fragmentSource, geometrySource);
+            m_ID = m_Build.Program;
 
-            vertex = glCreateShader(GL_VERTEX_SHADER);
-            glShaderSource(vertex, 1, &vShaderSource, nullptr);
-            CompileShader(vertex, ShaderType::Vert);
+            if (build == ShaderBuild::Immediate)
+                WaitUntilReady();
+        }
+
+        ~Shader()
+        {
+            if (s_BoundProgram == m_ID)
+                Unuse();
+
+            DiscardBuild(m_Build);
+            if (m_Reloading)
+                DiscardBuild(m_ReloadBuild);
+
+            glDeleteProgram(m_ID);
+        }
+
+        /// <summary>
+        /// Binds this program. Does nothing if it is already bound.
+        /// </summary>
+        void Use()
+        {
+            if (s_BoundProgram != m_ID)
+            {
+                glUseProgram(m_ID);
+                s_BoundProgram = m_ID;
+            }
+        }
+
+        /// <summary>
+        /// Unbinds any program. Not needed between draws.
+        /// </summary>
+        void Unuse()
+        {
+            if (s_BoundProgram != 0)
+            {
+                glUseProgram(0);
+                s_BoundProgram = 0;
+            }
+        }
+
+        /// <summary>
+        /// Call this if you called glUseProgram yourself, so next Use() binds again.
+        /// </summary>
+        static void InvalidateBinding()
+        {
+            s_BoundProgram = ~0u;
+        }
+
+        /// <summary>
+        /// <para>Enables on-disk cache of linked program binaries (glGetProgramBinary).</para>
+        /// <para>Key is hash of sources and GL vendor/renderer/version. Rejected binaries are recompiled.</para>
+        /// </summary>
+        /// <param name="directory">Cache directory. Empty string disables cache.</param>
+        static void SetBinaryCacheDirectory(const std::string& directory)
+        {
+            s_BinaryCacheDirectory = directory;
+        }
+
+        /// <summary>
+        /// Sets Matrix 4x4 to this shader.
+        /// </summary>
+        /// <param name="name">Name of matrix in shader</param>
+        /// <param name="count">Count</param>
+        /// <param name="transpose">is transpose?</param>
+        /// <param name="v">Value</param>
+        void SetMat4(UniformID name, int count, bool transpose, const glm::mat4& v)
+        {
+            // Shadow holds value as program sees it, so transposed and plain uploads of same matrix compare equal.
+            glm::mat4 value = transpose ? glm::transpose(v) : v;
+
+            const UniformSlot* slot = FindUniform(name);
+            if (!UpdateShadow(slot, count, &value, sizeof(value)))
+                return;
+
+            int location = slot != nullptr ? slot->Location : -1;
+
+            if (HasProgramUniform())
+            {
+                glProgramUniformMatrix4fv(m_ID, location, count, transpose, glm::value_ptr(v));
+            }
+            else
+            {
+                Use();
+                glUniformMatrix4fv(location, count, transpose, glm::value_ptr(v));
+            }
+        }
+
+        /// <summary>
+        /// Sets Vector4 to this shader.
+        /// </summary>
+        /// <param name="name">Name of vector in shader</param>
+        /// <param name="count">Count</param>
+        /// <param name="v">Value</param>
+        void SetVec4(UniformID name, int count, const glm::vec4& v)
+        {
+            const UniformSlot* slot = FindUniform(name);
+            if (!UpdateShadow(slot, count, &v, sizeof(v)))
+                return;
+
+            int location = slot != nullptr ? slot->Location : -1;
+
+            if (HasProgramUniform())
+            {
+                glProgramUniform4fv(m_ID, location, count, glm::value_ptr(v));
+            }
+            else
+            {
+                Use();
+                glUniform4fv(location, count, glm::value_ptr(v));
+            }
+        }
+
+        /// <summary>
+        /// Sets Vector3 to this shader.
+        /// </summary>
+        /// <param name="name">Name of vector in shader</param>
+        /// <param name="count">Count</param>
+        /// <param name="v">Value</param>
+        void SetVec3(UniformID name, int count, const glm::vec3& v)
+        {
+            const UniformSlot* slot = FindUniform(name);
+            if (!UpdateShadow(slot, count, &v, sizeof(v)))
+                return;
+
+            int location = slot != nullptr ? slot->Location : -1;
+
+            if (HasProgramUniform())
+            {
+                glProgramUniform3fv(m_ID, location, count, glm::value_ptr(v));
+            }
+            else
+            {
+                Use();
+                glUniform3fv(location, count, glm::value_ptr(v));
+            }
+        }
+
+        /// <summary>
+        /// Sets Vector2 to this shader.
+        /// </summary>
+        /// <param name="name">Name of vector in shader</param>
+        /// <param name="count">Count</param>
+        /// <param name="v">Value</param>
+        void SetVec2(UniformID name, int count, const glm::vec2& v)
+        {
+            const UniformSlot* slot = FindUniform(name);
+            if (!UpdateShadow(slot, count, &v, sizeof(v)))
+                return;
+
+            int location = slot != nullptr ? slot->Location : -1;
+
+            if (HasProgramUniform())
+            {
+                glProgramUniform2fv(m_ID, location, count, glm::value_ptr(v));
+            }
+            else
+            {
+                Use();
+                glUniform2fv(location, count, glm::value_ptr(v));
+            }
+        }
+
+        /// <summary>
+        /// Sets Float to this shader.
+        /// </summary>
+        /// <param name="name">Name of float in shader</param>
+        /// <param name="v">Value</param>
+        void SetFloat(UniformID name, float v)
+        {
+            const UniformSlot* slot = FindUniform(name);
+            if (!UpdateShadow(slot, 1, &v, sizeof(v)))
+                return;
+
+            int location = slot != nullptr ? slot->Location : -1;
+
+            if (HasProgramUniform())
+            {
+                glProgramUniform1f(m_ID, location, v);
+            }
+            else
+            {
+                Use();
+                glUniform1f(location, v);
+            }
+        }
+
+        /// <summary>
+        /// Sets Int to this shader.
+        /// </summary>
+        /// <param name="name">Name of int in shader</param>
+        /// <param name="v">Value</param>
+        void SetInt(UniformID name, int v)
+        {
+            const UniformSlot* slot = FindUniform(name);
+            if (!UpdateShadow(slot, 1, &v, sizeof(v)))
+                return;
+
+            int location = slot != nullptr ? slot->Location : -1;
+
+            if (HasProgramUniform())
+            {
+                glProgramUniform1i(m_ID, location, v);
+            }
+            else
+            {
+                Use();
+                glUniform1i(location, v);
+            }
+        }
+
+        /// <summary>
+        /// Sets Bool to this shader.
+        /// </summary>
+        /// <param name="name">Name of bool in shader</param>
+        /// <param name="v">Value</param>
+        void SetBool(UniformID name, bool v)
+        {
+            SetInt(name, v ? 1 : 0);
+        }
+
+        /// <summary>
+        /// Forgets shadowed uniform values. Call after setting uniforms of this program with raw glUniform* calls.
+        /// </summary>
+        void InvalidateUniformShadow()
+        {
+            for (UniformShadow& shadow : m_UniformShadows)
+                shadow.Size = 0;
+        }
+
+        /// <returns>Number of uniform uploads sent to driver (all shaders)</returns>
+        static uint64_t GetUniformUploadCount()
+        {
+            return s_UniformUploads;
+        }
+
+        /// <returns>Number of uniform uploads skipped because value was unchanged (all shaders)</returns>
+        static uint64_t GetElidedUniformUploadCount()
+        {
+            return s_UniformUploadsElided;
+        }
+
+        static void ResetUniformUploadCounters()
+        {
+            s_UniformUploads = 0;
+            s_UniformUploadsElided = 0;
+        }
+
+        /// <summary>
+        /// <para>Checks if deferred build finished. Never blocks when driver supports parallel shader compile.</para>
+        /// <para>Until it returns true skip drawing with this shader or use placeholder.</para>
+        /// </summary>
+        /// <returns>True or false</returns>
+        bool IsReady()
+        {
+            if (m_Ready)
+                return true;
+
+            if (!IsBuildComplete(m_Build))
+                return false;
+
+            WaitUntilReady();
+            return true;
+        }
+
+        /// <summary>
+        /// Blocks until deferred build is finished, then checks errors and reflects uniforms.
+        /// </summary>
+        void WaitUntilReady()
+        {
+            if (m_Ready)
+                return;
+
+            FinishBuild(m_Build);
+            ReflectUniforms();
+            m_Ready = true;
+        }
+
+        /// <summary>
+        /// <para>Starts building new program from sources. Current program stays in use until UpdateReload() swaps it.</para>
+        /// <para>Usually called by ShaderHotReloader.</para>
+        /// </summary>
+        void BeginReload(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource)
+        {
+            if (m_Reloading)
+            {
+                DiscardBuild(m_ReloadBuild);
+                glDeleteProgram(m_ReloadBuild.Program);
+            }
+
+            m_ReloadBuild = SubmitProgram(vertexSource, fragmentSource, geometrySource);
+            m_Reloading = true;
+        }
+
+        /// <summary>
+        /// <para>Call at frame boundary. When reload build is finished, swaps program and re-reflects uniform locations.</para>
+        /// <para>If new program fails to link, old one is kept.</para>
+        /// </summary>
+        /// <returns>True if program was swapped</returns>
+        bool UpdateReload()
+        {
+            if (!m_Reloading || !IsBuildComplete(m_ReloadBuild))
+                return false;
+
+            m_Reloading = false;
+
+            if (!FinishBuild(m_ReloadBuild))
+            {
+                Log("Warning! << Shader reload failed, keeping previous program.");
+                glDeleteProgram(m_ReloadBuild.Program);
+                return false;
+            }
+
+            WaitUntilReady();
+            if (s_BoundProgram == m_ID)
+                Unuse();
+            glDeleteProgram(m_ID);
+
+            m_ID = m_ReloadBuild.Program;
+            ReflectUniforms();
+
+            Log("Info! << Shader reloaded.");
+            return true;
+        }
+
+        /// <returns>Sorted defines this shader was built with</returns>
+        const ShaderDefines& GetDefines() const
+        {
+            return m_Defines;
+        }
+
+        /// <returns>Defines sorted and without duplicates, so same set always gives same variant</returns>
+        static ShaderDefines NormalizeDefines(ShaderDefines defines)
+        {
+            std::sort(defines.begin(), defines.end());
+            defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+            return defines;
+        }
+
+        /// <returns>Files this shader was built from, including #include'd ones. Index is #line source number in compiler errors of any stage.</returns>
+        const std::vector<std::string>& GetSourceFiles() const
+        {
+            return m_Dependencies;
+        }
+
+        /// <returns>True if shader has active uniform with this name</returns>
+        bool HasUniform(UniformID name) const
+        {
+            return GetUniformLocation(name) >= 0;
+        }
+
+        /// <returns>Reflected layout of uniform block or nullptr if shader has no such block</returns>
+        const UniformBlockLayout* GetUniformBlock(UniformID name) const
+        {
+            for (const UniformBlockLayout& block : m_UniformBlocks)
+            {
+                if (block.Hash == name.Hash)
+                    return &block;
+            }
+            return nullptr;
+        }
+
+        /// <summary>
+        /// <para>Connects uniform block to buffer binding point. Kept across hot reloads.</para>
+        /// <para>Block named FrameConstants is bound to FrameConstantsBinding automatically.</para>
+        /// </summary>
+        void BindUniformBlock(UniformID name, unsigned int binding)
+        {
+            m_UniformBlockBindings[name.Hash] = binding;
+
+            const UniformBlockLayout* block = GetUniformBlock(name);
+            if (block != nullptr)
+                glUniformBlockBinding(m_ID, block->Index, binding);
+        }
+
+    private:
+        // glProgramUniform* (GL 4.1) sets uniforms without binding program.
+        static bool HasProgramUniform()
+        {
+            return GLAD_GL_VERSION_4_1 != 0;
+        }
+
+        /// <returns>Slot of active uniform (location and shadow) or nullptr</returns>
+        const UniformSlot* FindUniform(UniformID name) const
+        {
+            auto uniformIter = std::lower_bound(m_Uniforms.begin(), m_Uniforms.end(), name.Hash,
+                [](const UniformSlot& slot, uint32_t hash) { return slot.Hash < hash; });
+
+            if (uniformIter != m_Uniforms.end() && uniformIter->Hash == name.Hash)
+                return &*uniformIter;
+
+            return nullptr;
+        }
+
+        /// <returns>Location of uniform or -1 if shader has no such active uniform</returns>
+        int GetUniformLocation(UniformID name) const
+        {
+            const UniformSlot* slot = FindUniform(name);
+            return slot != nullptr ? slot->Location : -1;
+        }
+
+        /// <summary>
+        /// Compares value with last uploaded one and stores it. Slot comes from FindUniform(), so setters search once.
+        /// </summary>
+        /// <returns>False if upload can be skipped</returns>
+        bool UpdateShadow(const UniformSlot* slot, int count, const void* value, size_t size)
+        {
+            if (slot == nullptr)
+            {
+                // Deferred program has no reflected uniforms yet, value would be lost silently.
+                if (!m_Ready)
+                {
+                    if (!m_WarnedNotReady)
+                        Log("Warning! << Uniform set before deferred shader is ready, value is dropped: " << m_Paths[0]);
+                    m_WarnedNotReady = true;
+                    return false;
+                }
+
+                ++s_UniformUploads;
+                return true;
+            }
+
+            UniformShadow& shadow = m_UniformShadows[slot->Shadow];
+
+            // Array uploads are not shadowed, they also overwrite first element.
+            if (count != 1)
+            {
+                shadow.Size = 0;
+                ++s_UniformUploads;
+                return true;
+            }
+
+            if (shadow.Size == size && std::memcmp(shadow.Bytes, value, size) == 0)
+            {
+                ++s_UniformUploadsElided;
+                return false;
+            }
+
+            std::memcpy(shadow.Bytes, value, size);
+            shadow.Size = size;
+            ++s_UniformUploads;
+            return true;
+        }
+
+        void ReflectUniforms()
+        {
+            m_Uniforms.clear();
+            m_UniformShadows.clear();
+
+            int uniformCount = 0, maxNameLength = 0;
+            glGetProgramiv(m_ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+            glGetProgramiv(m_ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+            std::vector<char> nameBuffer(static_cast<size_t>(maxNameLength) + 1);
+
+            for (int i = 0; i < uniformCount; ++i)
+            {
+                int size = 0, length = 0;
+                unsigned int type = 0;
+                glGetActiveUniform(m_ID, static_cast<unsigned int>(i), maxNameLength, &length, &size, &type, nameBuffer.data());
+
+                std::string name(nameBuffer.data(), static_cast<size_t>(length));
+                int location = glGetUniformLocation(m_ID, name.c_str());
+                if (location < 0)
+                    continue; // Member of uniform block.
+
+                // New program starts with default values, nothing is shadowed yet.
+                size_t shadow = m_UniformShadows.size();
+                m_UniformShadows.emplace_back();
+
+                m_Uniforms.push_back({ HashName(name.c_str()), location, shadow });
+
+                // Arrays are reported as "name[0]", make plain "name" work too.
+                if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+                    m_Uniforms.push_back({ HashName(name.substr(0, name.size() - 3).c_str()), location, shadow });
+            }
+
+            std::sort(m_Uniforms.begin(), m_Uniforms.end(),
+                [](const UniformSlot& a, const UniformSlot& b) { return a.Hash < b.Hash; });
+
+            for (size_t i = 1; i < m_Uniforms.size(); ++i)
+            {
+                if (m_Uniforms[i].Hash == m_Uniforms[i - 1].Hash && m_Uniforms[i].Location != m_Uniforms[i - 1].Location)
+                    Log("Warning! << Two uniforms in shader have same name hash, one of them is unreachable.");
+            }
+
+            ReflectUniformBlocks();
+        }
+
+        void ReflectUniformBlocks()
+        {
+            m_UniformBlocks.clear();
+
+            int blockCount = 0, maxBlockNameLength = 0, maxNameLength = 0;
+            glGetProgramiv(m_ID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+            glGetProgramiv(m_ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+            glGetProgramiv(m_ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+            std::vector<char> nameBuffer(static_cast<size_t>(std::max(maxBlockNameLength, maxNameLength)) + 1);
+
+            for (int i = 0; i < blockCount; ++i)
+            {
+                UniformBlockLayout block;
+                block.Index = static_cast<unsigned int>(i);
+
+                int length = 0;
+                glGetActiveUniformBlockName(m_ID, block.Index, static_cast<int>(nameBuffer.size()), &length, nameBuffer.data());
+                block.Name.assign(nameBuffer.data(), static_cast<size_t>(length));
+                block.Hash = HashName(block.Name.c_str());
+
+                int memberCount = 0;
+                glGetActiveUniformBlockiv(m_ID, block.Index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.DataSize);
+                glGetActiveUniformBlockiv(m_ID, block.Index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+
+                std::vector<int> indices(static_cast<size_t>(memberCount));
+                if (memberCount > 0)
+                    glGetActiveUniformBlockiv(m_ID, block.Index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+
+                for (int index : indices)
+                {
+                    unsigned int uniformIndex = static_cast<unsigned int>(index);
+
+                    UniformBlockMember member;
+                    glGetActiveUniformName(m_ID, uniformIndex, static_cast<int>(nameBuffer.size()), &length, nameBuffer.data());
+                    glGetActiveUniformsiv(m_ID, 1, &uniformIndex, GL_UNIFORM_TYPE, reinterpret_cast<int*>(&member.Type));
+                    glGetActiveUniformsiv(m_ID, 1, &uniformIndex, GL_UNIFORM_OFFSET, &member.Offset);
+                    glGetActiveUniformsiv(m_ID, 1, &uniformIndex, GL_UNIFORM_SIZE, &member.Size);
+                    glGetActiveUniformsiv(m_ID, 1, &uniformIndex, GL_UNIFORM_ARRAY_STRIDE, &member.ArrayStride);
+                    glGetActiveUniformsiv(m_ID, 1, &uniformIndex, GL_UNIFORM_MATRIX_STRIDE, &member.MatrixStride);
+                    member.Bytes = GetStd140Bytes(member);
+
+                    std::string name(nameBuffer.data(), static_cast<size_t>(length));
+                    if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+                        name.resize(name.size() - 3);
+
+                    member.Hash = HashName(name.c_str());
+                    block.Members.push_back(member);
+
+                    // Members of named blocks are reported as "Block.member", make plain "member" work too.
+                    size_t dot = name.find('.');
+                    if (dot != std::string::npos)
+                    {
+                        member.Hash = HashName(name.substr(dot + 1).c_str());
+                        block.Members.push_back(member);
+                    }
+                }
+
+                m_UniformBlocks.push_back(std::move(block));
+            }
+
+            m_UniformBlockBindings.emplace(HashName("FrameConstants"), FrameConstantsBinding);
+            for (const UniformBlockLayout& block : m_UniformBlocks)
+            {
+                auto binding = m_UniformBlockBindings.find(block.Hash);
+                if (binding != m_UniformBlockBindings.end())
+                    glUniformBlockBinding(m_ID, block.Index, binding->second);
+            }
+        }
+
+        static int GetStd140Bytes(const UniformBlockMember& member)
+        {
+            int columns = 1, columnBytes = 4;
+            switch (member.Type)
+            {
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2:
+                columnBytes = 8;
+                break;
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3:
+                columnBytes = 12;
+                break;
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4:
+                columnBytes = 16;
+                break;
+            case GL_FLOAT_MAT2: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT4x2:
+                columns = member.Type == GL_FLOAT_MAT2 ? 2 : member.Type == GL_FLOAT_MAT3x2 ? 3 : 4;
+                columnBytes = 8;
+                break;
+            case GL_FLOAT_MAT3: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT4x3:
+                columns = member.Type == GL_FLOAT_MAT3 ? 3 : member.Type == GL_FLOAT_MAT2x3 ? 2 : 4;
+                columnBytes = 12;
+                break;
+            case GL_FLOAT_MAT4: case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x4:
+                columns = member.Type == GL_FLOAT_MAT4 ? 4 : member.Type == GL_FLOAT_MAT2x4 ? 2 : 3;
+                columnBytes = 16;
+                break;
+            default:
+                break;
+            }
+
+            int elementBytes = columns > 1 ? member.MatrixStride * (columns - 1) + columnBytes : columnBytes;
+            return member.Size > 1 ? member.ArrayStride * (member.Size - 1) + elementBytes : elementBytes;
+        }
+
+        /// <param name="dependencies">If not null, files used by source are appended (without duplicates) and #line source numbers index it,
+        /// so passing same vector for every stage numbers files across whole program</param>
+        static std::string GetShaderSource(const std::string& path, const ShaderDefines& defines = {}, std::vector<std::string>* dependencies = nullptr)
+        {
+            if (path.empty())
+                return "";
+
+            PreprocessedShader source = ShaderPreprocessor::Process(path, dependencies);
+
+            if (source.Source.empty())
+                return "";
+
+            return InjectDefines(source.Source, defines);
+        }
+
+        /// <summary>
+        /// Inserts #define lines after #version (which must stay first) and restores line numbers with #line.
+        /// </summary>
+        static std::string InjectDefines(const std::string& source, const ShaderDefines& defines)
+        {
+            if (defines.empty())
+                return source;
+
+            size_t insertAt = 0;
+            int nextLine = 1;
+            std::string block;
+
+            size_t version = source.find("#version");
+            if (version != std::string::npos)
+            {
+                size_t lineEnd = source.find('\n', version);
+                if (lineEnd == std::string::npos)
+                {
+                    insertAt = source.size();
+                    block = "\n";
+                }
+                else
+                {
+                    insertAt = lineEnd + 1;
+                }
+                nextLine = static_cast<int>(std::count(source.begin(), source.begin() + version, '\n')) + 2;
+            }
+
+            for (const std::string& define : defines)
+                block += "#define " + define + "\n";
+            block += "#line " + std::to_string(nextLine) + "\n";
+
+            std::string result = source;
+            result.insert(insertAt, block);
+            return result;
+        }
+
+        /// <summary>
+        /// Starts building program. Only loading cached binary waits for driver.
+        /// </summary>
+        static ProgramBuild SubmitProgram(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource)
+        {
+            EnableParallelCompile();
+
+            ProgramBuild build;
+            build.CachePath = GetBinaryCachePath(vertexSource, fragmentSource, geometrySource);
+
+            if (!build.CachePath.empty())
+            {
+                build.Program = LoadProgramBinary(build.CachePath);
+                if (build.Program != 0)
+                {
+                    build.FromCache = true;
+                    return build;
+                }
+            }
+
+            build.Program = glCreateProgram();
+
+            build.Stages[(int)ShaderType::Vert] = SubmitShader(GL_VERTEX_SHADER, vertexSource);
+            build.Stages[(int)ShaderType::Frag] = SubmitShader(GL_FRAGMENT_SHADER, fragmentSource);
+            if (!geometrySource.empty())
+                build.Stages[(int)ShaderType::Geom] = SubmitShader(GL_GEOMETRY_SHADER, geometrySource);
+
+            for (unsigned int stage : build.Stages)
+            {
+                if (stage != 0)
+                    glAttachShader(build.Program, stage);
+            }
+
+            if (!build.CachePath.empty())
+                glProgramParameteri(build.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+            glLinkProgram(build.Program);
+
+            return build;
+        }
+
+        static unsigned int SubmitShader(unsigned int type, const std::string& source)
+        {
+            const char* shaderSource = source.c_str();
+            unsigned int shader = glCreateShader(type);
+            glShaderSource(shader, 1, &shaderSource, nullptr);
+            glCompileShader(shader);
+            return shader;
+        }
+
+        /// <returns>True if querying build status would not block</returns>
+        static bool IsBuildComplete(const ProgramBuild& build)
+        {
+            if (build.FromCache || s_ParallelCompile != 1)
+                return true;
+
+            int complete = 0;
+            glGetProgramiv(build.Program, GL_COMPLETION_STATUS_KHR, &complete);
+            return complete != 0;
+        }
+
+        /// <summary>
+        /// Checks compile and link status, stores binary in cache and deletes stage objects.
+        /// </summary>
+        /// <returns>True if program is linked</returns>
+        static bool FinishBuild(ProgramBuild& build)
+        {
+            if (build.FromCache)
+                return true;
+
+            for (int i = 0; i < 3; ++i)
+            {
+                if (build.Stages[i] != 0)
+                    CheckCompileStatus(build.Stages[i], static_cast<ShaderType>(i));
+            }
+
+            bool linked = CheckLinkStatus(build.Program);
+            if (linked && !build.CachePath.empty())
+                SaveProgramBinary(build.Program, build.CachePath);
+
+            for (unsigned int& stage : build.Stages)
+            {
+                if (stage != 0)
+                {
+                    glDetachShader(build.Program, stage);
+                    glDeleteShader(stage);
+                    stage = 0;
+                }
+            }
+
+            return linked;
+        }
+
+        /// <summary>
+        /// Deletes stage objects of unfinished build.
+        /// </summary>
+        static void DiscardBuild(ProgramBuild& build)
+        {
+            for (unsigned int& stage : build.Stages)
+            {
+                if (stage != 0)
+                    glDeleteShader(stage);
+                stage = 0;
+            }
+        }
+
+        static void EnableParallelCompile()
+        {
+            if (s_ParallelCompile != -1)
+                return;
+
+            s_ParallelCompile = 0;
+
+            using MaxShaderCompilerThreadsProc = void (APIENTRY*)(unsigned int count);
+            const char* extensions[] = { "GL_KHR_parallel_shader_compile", "GL_ARB_parallel_shader_compile" };
+            const char* functions[] = { "glMaxShaderCompilerThreadsKHR", "glMaxShaderCompilerThreadsARB" };
+
+            for (int i = 0; i < 2; ++i)
+            {
+                if (!HasGLExtension(extensions[i]))
+                    continue;
+
+                auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(SDL_GL_GetProcAddress(functions[i]));
+                if (maxShaderCompilerThreads)
+                    maxShaderCompilerThreads(0xFFFFFFFFu); // Let driver pick thread count.
+
+                s_ParallelCompile = 1;
+                return;
+            }
+        }
+
+        static bool CheckLinkStatus(unsigned int program)
+        {
+            int success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                char infoLog[1024];
+                glGetProgramInfoLog(program, 1024, nullptr, infoLog);
+                Log("Warning! << Failed to link shader program.\nInfoLog: \n" << infoLog << '\n');
+            }
+            return success != 0;
+        }
+
+        /// <returns>Path of cache file for these sources, or empty if cache is disabled/unsupported</returns>
+        static std::string GetBinaryCachePath(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource)
+        {
+            if (s_BinaryCacheDirectory.empty())
+                return "";
+
+            int formatCount = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+            if (formatCount <= 0)
+                return "";
+
+            uint64_t hash = HashBytes(nullptr, 0);
+            for (unsigned int name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+            {
+                const char* str = reinterpret_cast<const char*>(glGetString(name));
+                if (str)
+                    hash = HashBytes(str, std::char_traits<char>::length(str) + 1, hash);
+            }
+
+            for (const std::string* source : { &vertexSource, &fragmentSource, &geometrySource })
+                hash = HashBytes(source->c_str(), source->size() + 1, hash);
+
+            std::stringstream sStr;
+            sStr << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+            return (std::filesystem::path(s_BinaryCacheDirectory) / sStr.str()).string();
+        }
+
+        /// <returns>Linked program or 0 if there is no usable binary</returns>
+        static unsigned int LoadProgramBinary(const std::string& path)
+        {
+            MappedFile file(path);
+
+            uint32_t magic = 0, format = 0;
+            const size_t headerSize = sizeof(magic) + sizeof(format);
+            if (file.GetSize() <= headerSize)
+                return 0;
+
+            std::memcpy(&magic, file.GetData(), sizeof(magic));
+            std::memcpy(&format, file.GetData() + sizeof(magic), sizeof(format));
+            if (magic != ProgramBinaryMagic)
+                return 0;
+
+            unsigned int program = glCreateProgram();
+            glProgramBinary(program, format, file.GetData() + headerSize, static_cast<int>(file.GetSize() - headerSize));
+
+            int success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                // Driver update or different GPU, binary is stale.
+                Log("Info! << Cached shader binary rejected, recompiling: " << path);
+                glDeleteProgram(program);
+                return 0;
+            }
+
+            Log("Info! << Loaded cached shader binary: " << path);
+            return program;
+        }
+
+        static void SaveProgramBinary(unsigned int program, const std::string& path)
+        {
+            int length = 0;
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (length <= 0)
+                return;
+
+            std::vector<char> binary(static_cast<size_t>(length));
+            unsigned int format = 0;
+            glGetProgramBinary(program, length, &length, &format, binary.data());
+
+            std::error_code ec;
+            std::filesystem::create_directories(s_BinaryCacheDirectory, ec);
+
+            // Write to temporary file first so other processes never see half-written binary.
+            std::string tempPath = path + ".tmp";
+            {
+                std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                if (!file.is_open())
+                {
+                    Log("Warning! << Failed to write shader binary cache: " << path);
+                    return;
+                }
+
+                uint32_t magic = ProgramBinaryMagic, format32 = format;
+                file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+                file.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+                file.write(binary.data(), length);
+            }
+
+            std::filesystem::rename(tempPath, path, ec);
+            if (ec)
+                Log("Warning! << Failed to write shader binary cache: " << path);
+        }
+
+        static void CheckCompileStatus(unsigned int shader, ShaderType typeShader)
+        {
+            std::string shaderStringType =
+                (typeShader == ShaderType::Vert) ? "Vertex" :
+                (typeShader == ShaderType::Frag) ? "Fragment" :
+                (typeShader == ShaderType::Geom) ? "Geometry" :
+                "";
+
+            int success;
+
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                char infoLog[1024];
+                glGetShaderInfoLog(shader, 1024, nullptr, infoLog);
+                Log("Warning! << Failed to compile " << shaderStringType << " shader.\nInfoLog: \n" << infoLog << '\n');
+            }
+            else
+            {
+                Log("Info! << Succesfully compiled " << shaderStringType << " shader.");
+            }
+        }
+    };
+
+    /// <summary>
+    /// <para>Set of shader permutations built from same source files with different defines.</para>
+    /// <para>Each variant is compiled on first Get() and cached by its define set.</para>
+    /// <para>Source edits don't create new variants: watch variants with ShaderHotReloader (they rebuild in place) or call Clear().</para>
+    /// </summary>
+    class ShaderVariants
+    {
+    private:
+        std::string m_Paths[3];
+        ShaderBuild m_Build = ShaderBuild::Immediate;
+
+        std::map<std::string, std::shared_ptr<Shader>> m_Variants;
+
+    public:
+        /// <param name="build">Build mode used for every variant</param>
+        ShaderVariants(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath = "", ShaderBuild build = ShaderBuild::Immediate)
+            : m_Paths{ vertexShaderPath, fragmentShaderPath, geometryShaderPath }, m_Build(build)
+        {
+        }
+
+        /// <returns>Shader compiled with these defines. Order of defines does not matter.</returns>
+        std::shared_ptr<Shader> Get(const ShaderDefines& defines = {})
+        {
+            ShaderDefines normalized = Shader::NormalizeDefines(defines);
+
+            std::string key;
+            for (const std::string& define : normalized)
+                key += define + '\n';
+
+            std::shared_ptr<Shader>& variant = m_Variants[key];
+            if (variant == nullptr)
+                variant = std::make_shared<Shader>(m_Paths[0], m_Paths[1], m_Paths[2], m_Build, normalized);
+
+            return variant;
+        }
+
+        /// <returns>Number of compiled variants</returns>
+        size_t GetVariantCount() const
+        {
+            return m_Variants.size();
+        }
+
+        /// <summary>
+        /// Drops all cached variants (shaders still referenced elsewhere stay alive).
+        /// </summary>
+        void Clear()
+        {
+            m_Variants.clear();
+        }
+    };
+
+    /// <summary>
+    /// <para>Uniform buffer object with CPU-side copy of its data.</para>
+    /// <para>Set() writes members at offsets reflected from shader (std140), Upload() sends changed bytes in one call.</para>
+    /// </summary>
+    class UniformBuffer
+    {
+    private:
+        unsigned int m_ID = 0;
+
+        UniformBlockLayout m_Layout;
+        std::vector<uint8_t> m_Data;
+
+        size_t m_DirtyBegin = 0;
+        size_t m_DirtyEnd = 0;
+
+    public:
+        /// <param name="layout">Layout from Shader::GetUniformBlock()</param>
+        UniformBuffer(const UniformBlockLayout& layout, BufferUsage usage = BufferUsage::DynamicDraw)
+            : m_Layout(layout), m_Data(static_cast<size_t>(layout.DataSize), 0)
+        {
+            Create(usage);
+        }
+
+        /// <param name="size">Size in bytes. Use with SetData() for blocks mirrored by C++ struct.</param>
+        UniformBuffer(size_t size, BufferUsage usage = BufferUsage::DynamicDraw)
+            : m_Data(size, 0)
+        {
+            m_Layout.DataSize = static_cast<int>(size);
+            Create(usage);
+        }
+
+        ~UniformBuffer()
+        {
+            glDeleteBuffers(1, &m_ID);
+        }
+
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+        /// <summary>
+        /// Writes value of block member into CPU copy. Type must match std140 layout of member (float, int, vec2-4, mat4).
+        /// </summary>
+        template<typename T>
+        void Set(UniformID name, const T& value)
+        {
+            const UniformBlockMember* member = m_Layout.FindMember(name);
+            if (member == nullptr)
+                return;
+
+            if (sizeof(T) > static_cast<size_t>(member->Bytes))
+            {
+                Log("Warning! << Value is bigger than uniform block member in block " << m_Layout.Name);
+                return;
+            }
+
+            SetData(&value, sizeof(T), static_cast<size_t>(member->Offset));
+        }
+
+        /// <summary>
+        /// Writes mat3 column by column, std140 pads every column to vec4.
+        /// </summary>
+        void Set(UniformID name, const glm::mat3& value)
+        {
+            const UniformBlockMember* member = m_Layout.FindMember(name);
+            if (member == nullptr || member->Type != GL_FLOAT_MAT3)
+                return;
+
+            for (int column = 0; column < 3; ++column)
+                SetData(&value[column], sizeof(glm::vec3), static_cast<size_t>(member->Offset + column * member->MatrixStride));
+        }
+
+        /// <summary>
+        /// Writes raw bytes into CPU copy.
+        /// </summary>
+        void SetData(const void* data, size_t size, size_t offset = 0)
+        {
+            if (offset + size > m_Data.size())
+            {
+                Log("Warning! << Write outside of uniform buffer.");
+                return;
+            }
+
+            if (std::memcmp(m_Data.data() + offset, data, size) == 0)
+                return;
+
+            std::memcpy(m_Data.data() + offset, data, size);
+
+            if (m_DirtyBegin == m_DirtyEnd)
+            {
+                m_DirtyBegin = offset;
+                m_DirtyEnd = offset + size;
+            }
+            else
+            {
+                m_DirtyBegin = std::min(m_DirtyBegin, offset);
+                m_DirtyEnd = std::max(m_DirtyEnd, offset + size);
+            }
+        }
+
+        /// <summary>
+        /// Uploads changed range of CPU copy to GPU in single call.
+        /// </summary>
+        void Upload()
+        {
+            if (m_DirtyBegin == m_DirtyEnd)
+                return;
+
+            glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+            glBufferSubData(GL_UNIFORM_BUFFER, m_DirtyBegin, m_DirtyEnd - m_DirtyBegin, m_Data.data() + m_DirtyBegin);
+            m_DirtyBegin = m_DirtyEnd = 0;
+        }
+
+        /// <summary>
+        /// Binds buffer to uniform buffer binding point (see Shader::BindUniformBlock()).
+        /// </summary>
+        void Bind(unsigned int binding) const
+        {
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_ID);
+        }
+
+        const UniformBlockLayout& GetLayout() const
+        {
+            return m_Layout;
+        }
+
+    private:
+        void Create(BufferUsage usage)
+        {
+            glGenBuffers(1, &m_ID);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_ID);
+            glBufferData(GL_UNIFORM_BUFFER, m_Data.size(), m_Data.data(), (unsigned int)usage);
+        }
+    };
+
+    /// <summary>
+    /// Buffer behind FrameConstants block. Update() once per frame uploads data and binds it to FrameConstantsBinding.
+    /// </summary>
+    class FrameConstantsBuffer
+    {
+    private:
+        UniformBuffer m_Buffer;
+
+    public:
+        FrameConstantsBuffer()
+            : m_Buffer(sizeof(FrameConstants))
+        {
+        }
+
+        void Update(const FrameConstants& constants)
+        {
+            m_Buffer.SetData(&constants, sizeof(FrameConstants));
+            m_Buffer.Upload();
+            m_Buffer.Bind(FrameConstantsBinding);
+        }
+    };
+
+#ifdef __linux__
+    /// <summary>
+    /// <para>Watches shader source files with inotify and rebuilds shaders when they change.</para>
+    /// <para>Files are read on background thread, compile runs as deferred build and program is swapped in Update().</para>
+    /// <para>Call Update() once per frame on thread that owns OpenGL context. Linux only.</para>
+    /// </summary>
+    class ShaderHotReloader
+    {
+    private:
+        struct WatchedShader
+        {
+            std::weak_ptr<Shader> Target;
+            std::string Paths[3];
+            ShaderDefines Defines;
+            std::vector<std::string> Files;
+
+            bool HasPendingSources = false;
+            std::string PendingSources[3];
+        };
+
+        int m_InotifyFd = -1;
+        int m_WakePipe[2] = { -1, -1 };
+
+        std::thread m_Thread;
+        std::mutex m_Mutex;
+
+        std::map<std::string, int> m_WatchedDirectories;
+        std::vector<WatchedShader> m_Shaders;
+
+    public:
+        ShaderHotReloader()
+        {
+            m_InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (m_InotifyFd < 0 || pipe(m_WakePipe) != 0)
+                Error("Failed to initialize inotify for shader hot reload.");
+
+            m_Thread = std::thread([this]() { WatchLoop(); });
+        }
+
+        ~ShaderHotReloader()
+        {
+            char wake = 0;
+            if (write(m_WakePipe[1], &wake, 1) < 0)
+                Log("Warning! << Failed to wake shader hot reload thread.");
+
+            if (m_Thread.joinable())
+                m_Thread.join();
+
+            close(m_WakePipe[0]);
+            close(m_WakePipe[1]);
+            close(m_InotifyFd);
+        }
+
+        ShaderHotReloader(const ShaderHotReloader&) = delete;
+        ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+        /// <summary>
+        /// Starts watching source files of shader. Shader is held weakly.
+        /// </summary>
+        void Watch(const std::shared_ptr<Shader>& shader)
+        {
+            if (shader == nullptr)
+                return;
+
+            WatchedShader watched;
+            watched.Target = shader;
+            for (int i = 0; i < 3; ++i)
+                watched.Paths[i] = shader->m_Paths[i];
+            watched.Defines = shader->m_Defines;
+
+            watched.Files = shader->GetSourceFiles();
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            WatchFiles(watched.Files);
+            m_Shaders.push_back(std::move(watched));
+        }
+
+        /// <summary>
+        /// Starts rebuilds for changed shaders and swaps programs whose rebuild finished. Call at frame boundary.
+        /// </summary>
+        /// <returns>Number of shaders swapped this call</returns>
+        int Update()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            int swapped = 0;
+            for (WatchedShader& watched : m_Shaders)
+            {
+                std::shared_ptr<Shader> shader = watched.Target.lock();
+                if (shader == nullptr)
+                    continue;
+
+                if (watched.HasPendingSources)
+                {
+                    shader->BeginReload(watched.PendingSources[0], watched.PendingSources[1], watched.PendingSources[2]);
+                    shader->m_Dependencies = watched.Files;
+                    watched.HasPendingSources = false;
+                }
+
+                if (shader->UpdateReload())
+                    ++swapped;
+            }
+
+            m_Shaders.erase(std::remove_if(m_Shaders.begin(), m_Shaders.end(),
+                [](const WatchedShader& watched) { return watched.Target.expired(); }), m_Shaders.end());
+
+            return swapped;
+        }
+
+    private:
+        /// <summary>
+        /// Watches directories of files. Caller holds m_Mutex.
+        /// </summary>
+        void WatchFiles(const std::vector<std::string>& files)
+        {
+            for (const std::string& file : files)
+            {
+                // Watch directory, not file, editors often save by writing new file and renaming it.
+                std::string directory = std::filesystem::path(file).parent_path().string();
+                if (m_WatchedDirectories.count(directory) != 0)
+                    continue;
+
+                int wd = inotify_add_watch(m_InotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (wd < 0)
+                {
+                    Log("Warning! << Failed to watch shader directory: " << directory);
+                    continue;
+                }
+                m_WatchedDirectories[directory] = wd;
+            }
+        }
+
+        void WatchLoop()
+        {
+            alignas(inotify_event) char buffer[4096];
+
+            pollfd fds[2] = { { m_InotifyFd, POLLIN, 0 }, { m_WakePipe[0], POLLIN, 0 } };
+
+            while (true)
+            {
+                if (poll(fds, 2, -1) < 0)
+                    continue;
+
+                if (fds[1].revents & POLLIN)
+                    return;
+
+                ssize_t length = 0;
+                while ((length = read(m_InotifyFd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char* ptr = buffer; ptr < buffer + length; )
+                    {
+                        const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                        ptr += sizeof(inotify_event) + event->len;
+
+                        if (event->len > 0)
+                            OnFileChanged(event->wd, event->name);
+                    }
+                }
+            }
+        }
+
+        void OnFileChanged(int wd, const char* name)
+        {
+            std::vector<WatchedShader> affected;
+            std::string changed;
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+
+                for (const auto& watchedDirectory : m_WatchedDirectories)
+                {
+                    if (watchedDirectory.second == wd)
+                        changed = (std::filesystem::path(watchedDirectory.first) / name).string();
+                }
+
+                for (const WatchedShader& watched : m_Shaders)
+                {
+                    if (std::find(watched.Files.begin(), watched.Files.end(), changed) != watched.Files.end())
+                        affected.push_back(watched);
+                }
+            }
+
+            if (affected.empty())
+                return;
+
+            Log("Info! << Shader source changed: " << changed);
+            ShaderSourceCache::Invalidate(changed);
+
+            // Read files without holding lock, so Update() on render thread never waits for disk.
+            for (WatchedShader& watched : affected)
+            {
+                watched.Files.clear();
+                for (int i = 0; i < 3; ++i)
+                    watched.PendingSources[i] = Shader::GetShaderSource(watched.Paths[i], watched.Defines, &watched.Files);
+            }
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (WatchedShader& source : affected)
+            {
+                for (WatchedShader& watched : m_Shaders)
+                {
+                    if (watched.Target.owner_before(source.Target) || source.Target.owner_before(watched.Target))
+                        continue;
+
+                    for (int i = 0; i < 3; ++i)
+                        watched.PendingSources[i] = source.PendingSources[i];
+                    watched.HasPendingSources = true;
+
+                    // Includes may have been added or removed.
+                    watched.Files = source.Files;
+                    WatchFiles(watched.Files);
+                }
+            }
+        }
+    };
+#endif
+
+    /// <summary>
+    /// <para>Runs work(i) for every i in [0, count) on at most hardware_concurrency() threads, calling thread included.</para>
+    /// <para>Only one level of parallelism: For() called from inside work, or from thread marked with MarkSerialThread(), runs on calling thread, so nested loops never multiply threads.</para>
+    /// </summary>
+    class Parallel
+    {
+    private:
+        static inline thread_local bool s_Serial = false;
+
+    public:
+        static size_t GetThreadCount()
+        {
+            unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            return hardwareThreads > 0 ? hardwareThreads : 1;
+        }
+
+        /// <summary>
+        /// Marks calling thread (e.g. background worker of pool) so For() on it never starts threads.
+        /// </summary>
+        static void MarkSerialThread()
+        {
+            s_Serial = true;
+        }
+
+        template<typename Function>
+        static void For(size_t count, Function&& work, size_t maxThreads = SIZE_MAX)
+        {
+            size_t threadCount = s_Serial ? 1 : std::min({ count, GetThreadCount(), maxThreads });
+            std::atomic<size_t> next{ 0 };
+
+            auto run = [&]()
+            {
+                bool serial = s_Serial;
+                s_Serial = true;
+                for (size_t i = next++; i < count; i = next++)
+                    work(i);
+                s_Serial = serial;
+            };
+
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < threadCount; ++i)
+            {
+                try
+                {
+                    threads.emplace_back(run);
+                }
+                catch (const std::system_error&)
+                {
+                    break;  // Out of threads, remaining work runs on threads already started
+                }
+            }
+
+            run();
+            for (std::thread& thread : threads)
+                thread.join();
+        }
+    };
+
+    /// <summary>
+    /// <para>Decoded 8-bit image in CPU memory. Load() is thread safe, so it can run on worker threads.</para>
+    /// <para>Flip is done per image, global stbi_set_flip_vertically_on_load() is never touched.</para>
+    /// </summary>
+    struct Image
+    {
+        std::vector<unsigned char> Pixels;
+        int Width = 0;
+        int Height = 0;
+        int Channels = 0;
+
+        bool IsValid() const
+        {
+            return !Pixels.empty();
+        }
+
+        size_t GetRowSize() const
+        {
+            return static_cast<size_t>(Width) * Channels;
+        }
+
+        /// <returns>Decoded image, invalid (empty) if file could not be read or decoded</returns>
+        static Image Load(const std::string& path, bool flipY)
+        {
+            Image image;
+
+            MappedFile file(path);
+            if (file.GetSize() == 0)
+                return image;
+
+            unsigned char* data = stbi_load_from_memory(file.GetData(), static_cast<int>(file.GetSize()), &image.Width, &image.Height, &image.Channels, 0);
+            if (data == nullptr)
+                return image;
+
+            image.Pixels.assign(data, data + image.GetRowSize() * image.Height);
+            stbi_image_free(data);
+
+            if (flipY)
+                image.FlipVertically();
+
+            return image;
+        }
+
+        /// <summary>
+        /// Decodes images in parallel (Parallel::For).
+        /// </summary>
+        /// <returns>Images in same order as paths, invalid ones failed to load</returns>
+        static std::vector<Image> LoadMany(const std::vector<std::string>& paths, bool flipY)
+        {
+            std::vector<Image> images(paths.size());
+            Parallel::For(paths.size(), [&](size_t i) { images[i] = Load(paths[i], flipY); });
+            return images;
+        }
+
+        void FlipVertically()
+        {
+            size_t rowSize = GetRowSize();
+            for (int top = 0, bottom = Height - 1; top < bottom; ++top, --bottom)
+                std::swap_ranges(Pixels.begin() + top * rowSize, Pixels.begin() + (top + 1) * rowSize, Pixels.begin() + bottom * rowSize);
+        }
+
+        /// <returns>Image of half size (at least 1x1), every pixel is average of 2x2 source pixels</returns>
+        static Image Downsample(const Image& source)
+        {
+            Image target;
+            target.Width = std::max(source.Width / 2, 1);
+            target.Height = std::max(source.Height / 2, 1);
+            target.Channels = source.Channels;
+            target.Pixels.resize(target.GetRowSize() * target.Height);
+
+            // Small levels are not worth starting threads for.
+            size_t chunkCount = 1;
+            if (target.Pixels.size() >= 256 * 1024)
+                chunkCount = std::min<size_t>(Parallel::GetThreadCount(), static_cast<size_t>(target.Height));
+
+            int rowsPerChunk = static_cast<int>((target.Height + chunkCount - 1) / chunkCount);
+            Parallel::For(chunkCount, [&](size_t i)
+            {
+                int first = static_cast<int>(i) * rowsPerChunk;
+                DownsampleRows(source, target, first, std::min(first + rowsPerChunk, target.Height));
+            });
+
+            return target;
+        }
+
+        /// <returns>Mip levels 1 to levelCount - 1 of image (level 0 is image itself)</returns>
+        static std::vector<Image> GenerateMipChain(const Image& image, int levelCount)
+        {
+            std::vector<Image> mips;
+            mips.reserve(static_cast<size_t>(std::max(levelCount - 1, 0)));
+
+            for (int level = 1; level < levelCount; ++level)
+                mips.push_back(Downsample(level == 1 ? image : mips.back()));
+
+            return mips;
+        }
+
+    private:
+        static void DownsampleRows(const Image& source, Image& target, int firstRow, int lastRow)
+        {
+            switch (source.Channels)
+            {
+            case 1: DownsampleRows<1>(source, target, firstRow, lastRow); break;
+            case 2: DownsampleRows<2>(source, target, firstRow, lastRow); break;
+            case 3: DownsampleRows<3>(source, target, firstRow, lastRow); break;
+            default: DownsampleRows<4>(source, target, firstRow, lastRow); break;
+            }
+        }
+
+        /// <summary>
+        /// <para>Channel count is compile-time constant and inner loop has no clamps, so compiler can unroll and vectorize it.</para>
+        /// <para>Edges are handled outside: last row is repeated for 1-pixel-high source, clamped column only exists for 1-pixel-wide source.</para>
+        /// </summary>
+        template<int Channels>
+        static void DownsampleRows(const Image& source, Image& target, int firstRow, int lastRow)
+        {
+            const size_t sourceRowSize = source.GetRowSize();
+
+            // Target columns whose both source columns lie inside image (all of them unless source is 1 pixel wide).
+            const int pairs = std::min(target.Width, source.Width / 2);
+
+            for (int y = firstRow; y < lastRow; ++y)
+            {
+                const unsigned char* __restrict top = source.Pixels.data() + std::min(y * 2, source.Height - 1) * sourceRowSize;
+                const unsigned char* __restrict bottom = source.Pixels.data() + std::min(y * 2 + 1, source.Height - 1) * sourceRowSize;
+                unsigned char* __restrict out = target.Pixels.data() + y * target.GetRowSize();
+
+                for (int x = 0; x < pairs; ++x)
+                {
+                    const unsigned char* t = top + x * 2 * Channels;
+                    const unsigned char* b = bottom + x * 2 * Channels;
+                    for (int c = 0; c < Channels; ++c)
+                        out[x * Channels + c] = static_cast<unsigned char>((t[c] + t[c + Channels] + b[c] + b[c + Channels] + 2) >> 2);
+                }
+
+                for (int x = pairs; x < target.Width; ++x)
+                {
+                    const size_t left = static_cast<size_t>(std::min(x * 2, source.Width - 1)) * Channels;
+                    const size_t right = static_cast<size_t>(std::min(x * 2 + 1, source.Width - 1)) * Channels;
+                    for (int c = 0; c < Channels; ++c)
+                        out[x * Channels + c] = static_cast<unsigned char>((top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c] + 2) >> 2);
+                }
+            }
+        }
+    };
+
+    /// <summary>
+    /// <para>Pre-mipped block-compressed image (BC1, BC3, BC5, BC7, ETC2) from DDS or KTX2 file.</para>
+    /// <para>File is memory mapped, levels point straight into it, so nothing is decoded or copied before upload.</para>
+    /// </summary>
+    struct CompressedImage
+    {
+        struct Level
+        {
+            const unsigned char* Data = nullptr;
+            size_t Size = 0;
+            int Width = 0;
+            int Height = 0;
+        };
+
+        MappedFile File;
+        unsigned int Format = 0;    // GL compressed internal format
+        int Width = 0;
+        int Height = 0;
+        std::vector<Level> Levels;
+
+        bool IsValid() const
+        {
+            return Format != 0 && !Levels.empty();
+        }
+
+        /// <returns>True for .dds and .ktx2 files</returns>
+        static bool IsCompressedFile(const std::string& path)
+        {
+            std::string extension = std::filesystem::path(path).extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return extension == ".dds" || extension == ".ktx2";
+        }
+
+        /// <returns>Image, invalid if file is missing, malformed or uses unsupported format</returns>
+        static CompressedImage Load(const std::string& path)
+        {
+            CompressedImage image;
+            if (!image.File.Open(path))
+                return image;
+
+            bool parsed = image.File.GetSize() >= 12 && std::memcmp(image.File.GetData(), KTX2Identifier, 12) == 0
+                ? image.ParseKTX2()
+                : image.ParseDDS();
+
+            if (!parsed)
+            {
+                image.Format = 0;
+                image.Levels.clear();
+            }
+            return image;
+        }
+
+        /// <returns>Bytes of one 4x4 block</returns>
+        static size_t GetBlockSize(unsigned int format)
+        {
+            switch (format)
+            {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RGB8_ETC2:
+            case GL_COMPRESSED_SRGB8_ETC2:
+            case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+            case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+                return 8;
+            default:
+                return 16;
+            }
+        }
+
+        static size_t GetLevelSize(unsigned int format, int width, int height)
+        {
+            return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+        }
+
+    private:
+        static constexpr unsigned char KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        template<typename T>
+        T Read(size_t offset) const
+        {
+            T value{};
+            if (offset + sizeof(T) <= File.GetSize())
+                std::memcpy(&value, File.GetData() + offset, sizeof(T));
+            return value;
+        }
+
+        static constexpr uint32_t FourCC(char a, char b, char c, char d)
+        {
+            return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+        }
+
+        /// <returns>Levels of full mip chain down to 1x1, more would not fit into glTexStorage2D</returns>
+        int GetMaxLevelCount() const
+        {
+            int levels = 1;
+            for (int size = std::max(Width, Height); size > 1; size /= 2)
+                ++levels;
+            return levels;
+        }
+
+        /// <summary>
+        /// Adds level if it lies inside file and has expected size.
+        /// </summary>
+        bool AddLevel(size_t offset, size_t size)
+        {
+            int level = static_cast<int>(Levels.size());
+            int width = std::max(Width >> level, 1);
+            int height = std::max(Height >> level, 1);
+
+            size_t expected = GetLevelSize(Format, width, height);
+            if (size < expected || offset > File.GetSize() || File.GetSize() - offset < expected)
+                return false;
+
+            Levels.push_back({ File.GetData() + offset, expected, width, height });
+            return true;
+        }
+
+        bool ParseDDS()
+        {
+            const size_t headerSize = 128, dx10HeaderSize = 20;
+            if (File.GetSize() < headerSize || Read<uint32_t>(0) != FourCC('D', 'D', 'S', ' '))
+                return false;
+
+            Height = static_cast<int>(Read<uint32_t>(12));
+            Width = static_cast<int>(Read<uint32_t>(16));
+            uint32_t flags = Read<uint32_t>(8);
+            uint32_t levelCount = (flags & 0x20000) ? std::max(Read<uint32_t>(28), 1u) : 1u;   // DDSD_MIPMAPCOUNT
+            uint32_t fourCC = Read<uint32_t>(84);
+            size_t offset = headerSize;
+
+            if (fourCC == FourCC('D', 'X', '1', '0'))
+            {
+                if (Read<uint32_t>(140) > 1 || (Read<uint32_t>(136) & 0x4) != 0)   // arraySize, TEXTURECUBE
+                    return false;
+
+                switch (Read<uint32_t>(128))    // DXGI_FORMAT
+                {
+                case 71: Format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+                case 72: Format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; break;
+                case 77: Format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+                case 78: Format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+                case 83: Format = GL_COMPRESSED_RG_RGTC2; break;
+                case 84: Format = GL_COMPRESSED_SIGNED_RG_RGTC2; break;
+                case 95: Format = GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT; break;
+                case 96: Format = GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT; break;
+                case 98: Format = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+                case 99: Format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
+                default: return false;
+                }
+                offset += dx10HeaderSize;
+            }
+            else if (fourCC == FourCC('D', 'X', 'T', '1')) Format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            else if (fourCC == FourCC('D', 'X', 'T', '5')) Format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            else if (fourCC == FourCC('A', 'T', 'I', '2') || fourCC == FourCC('B', 'C', '5', 'U')) Format = GL_COMPRESSED_RG_RGTC2;
+            else return false;
+
+            // Level count comes from file, more levels than full chain is malformed file (and Width >> level would overflow).
+            if (Width <= 0 || Height <= 0 || levelCount > static_cast<uint32_t>(GetMaxLevelCount()))
+                return false;
+
+            for (uint32_t level = 0; level < levelCount; ++level)
+            {
+                if (!AddLevel(offset, File.GetSize() - std::min(offset, File.GetSize())))
+                    return false;
+                offset += Levels.back().Size;
+            }
+            return true;
+        }
+
+        bool ParseKTX2()
+        {
+            const size_t levelIndexOffset = 80, levelIndexEntrySize = 24;
+
+            Width = static_cast<int>(Read<uint32_t>(20));
+            Height = static_cast<int>(Read<uint32_t>(24));
+            uint32_t depth = Read<uint32_t>(28), layers = Read<uint32_t>(32), faces = Read<uint32_t>(36);
+            uint32_t levelCount = std::max(Read<uint32_t>(40), 1u);
+
+            // Only plain 2D textures without supercompression (zstd/Basis would need decoder).
+            if (Width <= 0 || Height <= 0 || depth > 1 || layers > 1 || faces != 1 || Read<uint32_t>(44) != 0)
+                return false;
+
+            if (levelCount > static_cast<uint32_t>(GetMaxLevelCount()))
+                return false;
+
+            switch (Read<uint32_t>(12))     // VkFormat
+            {
+            case 131: Format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+            case 132: Format = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT; break;
+            case 133: Format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+            case 134: Format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; break;
+            case 137: Format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+            case 138: Format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+            case 141: Format = GL_COMPRESSED_RG_RGTC2; break;
+            case 142: Format = GL_COMPRESSED_SIGNED_RG_RGTC2; break;
+            case 143: Format = GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT; break;
+            case 144: Format = GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT; break;
+            case 145: Format = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+            case 146: Format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
+            case 147: Format = GL_COMPRESSED_RGB8_ETC2; break;
+            case 148: Format = GL_COMPRESSED_SRGB8_ETC2; break;
+            case 149: Format = GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2; break;
+            case 150: Format = GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2; break;
+            case 151: Format = GL_COMPRESSED_RGBA8_ETC2_EAC; break;
+            case 152: Format = GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC; break;
+            default: return false;
+            }
+
+            for (uint32_t level = 0; level < levelCount; ++level)
+            {
+                size_t entry = levelIndexOffset + level * levelIndexEntrySize;
+                if (!AddLevel(static_cast<size_t>(Read<uint64_t>(entry)), static_cast<size_t>(Read<uint64_t>(entry + 8))))
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    class Texture
+    {
+        friend class TextureLoader;
+
+    private:
+        unsigned int m_ID = 0;
+        int m_Width = 0;
+        int m_Height = 0;
+        int m_Channels = 0;
+        int m_Depth = 1;    // Layers of array, slices of 3D texture, 6 for cubemap
+        int m_LevelCount = 0;
+        size_t m_CompressedBytes = 0;   // Non-zero for block-compressed textures
+        bool m_UseMipmaps = false;
+        TextureType m_Type{};
+
+        // Texture last bound to each unit and active unit, so Bind() skips redundant GL calls.
+        static constexpr unsigned int TrackedUnitCount = 32;
+        static inline std::array<unsigned int, TrackedUnitCount> s_BoundTextures{};
+        static inline unsigned int s_ActiveUnit = 0;
+
+        /// <summary>
+        /// Binds texture to active unit for creating/uploading it, keeping binding cache correct.
+        /// </summary>
+        void BindForUpdate() const
+        {
+            glBindTexture((unsigned int)m_Type, m_ID);
+            if (s_ActiveUnit < TrackedUnitCount)
+                s_BoundTextures[s_ActiveUnit] = m_ID;
+        }
+
+        /// <summary>
+        /// Deleted texture is unbound from all units by GL.
+        /// </summary>
+        void Delete()
+        {
+            if (m_ID == 0)
+                return;
+
+            glDeleteTextures(1, &m_ID);
+            for (unsigned int& bound : s_BoundTextures)
+            {
+                if (bound == m_ID)
+                    bound = 0;
+            }
+            m_ID = 0;
+        }
+
+        /// <summary>
+        /// Creates texture object with parameters but without image.
+        /// </summary>
+        Texture(TextureType type, WrapMode wrapS, WrapMode wrapT, WrapMode wrapR, MinFilter minFilter, MagFilter magFilter)
+            : m_UseMipmaps(UsesMipmaps(minFilter)), m_Type(type)
+        {
+            glGenTextures(1, &m_ID);
+            BindForUpdate();
+
+            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_WRAP_S, (int)wrapS);
+            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_WRAP_T, (int)wrapT);
+            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_WRAP_R, (int)wrapR);
+            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_MIN_FILTER, (int)minFilter);
+            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_MAG_FILTER, (int)magFilter);
+        }
+
+        static unsigned int GetFormat(int channels)
+        {
+            if (channels == 1) return GL_RED;
+            else if (channels == 2) return GL_RG;
+            else if (channels == 4) return GL_RGBA;
+            return GL_RGB;
+        }
+
+        static unsigned int GetInternalFormat(int channels)
+        {
+            if (channels == 1) return GL_R8;
+            else if (channels == 2) return GL_RG8;
+            else if (channels == 4) return GL_RGBA8;
+            return GL_RGB8;
+        }
+
+        static bool UsesMipmaps(MinFilter minFilter)
+        {
+            return minFilter != MinFilter::Nearest && minFilter != MinFilter::Linear;
+        }
+
+        // glTexStorage* (GL 4.2) allocates immutable storage once, with exact number of levels.
+        static bool HasTextureStorage()
+        {
+            return GLAD_GL_VERSION_4_2 != 0;
+        }
+
+        /// <returns>Levels of full mip chain down to 1x1</returns>
+        static int GetMipLevelCount(int width, int height, int depth = 1)
+        {
+            int levels = 1;
+            for (int size = std::max({ width, height, depth }); size > 1; size /= 2)
+                ++levels;
+            return levels;
+        }
+
+        /// <summary>
+        /// Allocates all levels of texture. Texture must be bound. Only levels sampled by min filter are allocated.
+        /// </summary>
+        /// <param name="maxLevelCount">Limit of mip levels, 0 = full chain</param>
+        void Allocate(int width, int height, int channels, int depth = 1, int maxLevelCount = 0)
+        {
+            m_Width = width;
+            m_Height = height;
+            m_Channels = channels;
+            m_Depth = depth;
+
+            bool is3D = m_Type == TextureType::Texture3D;
+            bool isLayered = is3D || m_Type == TextureType::Texture2DArray;
+            m_LevelCount = m_UseMipmaps ? GetMipLevelCount(width, height, is3D ? depth : 1) : 1;
+            if (maxLevelCount > 0)
+                m_LevelCount = std::min(m_LevelCount, maxLevelCount);
+
+            unsigned int target = (unsigned int)m_Type;
+            unsigned int internalFormat = GetInternalFormat(channels);
+
+            if (HasTextureStorage())
+            {
+                if (isLayered)
+                    glTexStorage3D(target, m_LevelCount, internalFormat, width, height, depth);
+                else
+                    glTexStorage2D(target, m_LevelCount, internalFormat, width, height);
+                return;
+            }
+
+            unsigned int format = GetFormat(channels);
+            for (int level = 0; level < m_LevelCount; ++level)
+            {
+                int levelWidth = std::max(width >> level, 1);
+                int levelHeight = std::max(height >> level, 1);
+                int levelDepth = is3D ? std::max(depth >> level, 1) : depth;
+
+                if (isLayered)
+                {
+                    glTexImage3D(target, level, internalFormat, levelWidth, levelHeight, levelDepth, 0, format, GL_UNSIGNED_BYTE, nullptr);
+                }
+                else if (m_Type == TextureType::TextureCubemap)
+                {
+                    for (int face = 0; face < 6; ++face)
+                        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, internalFormat, levelWidth, levelHeight, 0, format, GL_UNSIGNED_BYTE, nullptr);
+                }
+                else
+                {
+                    glTexImage2D(target, level, internalFormat, levelWidth, levelHeight, 0, format, GL_UNSIGNED_BYTE, nullptr);
+                }
+            }
+            glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, m_LevelCount - 1);
+        }
+
+        /// <summary>
+        /// Writes one level of 2D texture, layer of array texture or face of cubemap. Texture must be bound.
+        /// </summary>
+        void UploadLevel(const Image& image, int level, int layer = 0)
+        {
+            unsigned int format = GetFormat(image.Channels);
+
+            // Rows of 1 and 3 channel images are not 4-byte aligned.
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            if (m_Type == TextureType::TextureCubemap)
+                glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer, level, 0, 0, image.Width, image.Height, format, GL_UNSIGNED_BYTE, image.Pixels.data());
+            else if (m_Type == TextureType::Texture2DArray || m_Type == TextureType::Texture3D)
+                glTexSubImage3D((unsigned int)m_Type, level, 0, 0, layer, image.Width, image.Height, 1, format, GL_UNSIGNED_BYTE, image.Pixels.data());
+            else
+                glTexSubImage2D((unsigned int)m_Type, level, 0, 0, image.Width, image.Height, format, GL_UNSIGNED_BYTE, image.Pixels.data());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+
+        void UploadCompressed(const CompressedImage& image)
+        {
+            m_Width = image.Width;
+            m_Height = image.Height;
+            m_Channels = 0;
+            m_Depth = 1;
+
+            // File holds whole mip chain, just use levels min filter samples.
+            m_LevelCount = m_UseMipmaps ? static_cast<int>(image.Levels.size()) : 1;
+
+            unsigned int target = (unsigned int)m_Type;
+            if (HasTextureStorage())
+                glTexStorage2D(target, m_LevelCount, image.Format, m_Width, m_Height);
+
+            m_CompressedBytes = 0;
+            for (int level = 0; level < m_LevelCount; ++level)
+            {
+                const CompressedImage::Level& data = image.Levels[level];
+                if (HasTextureStorage())
+                    glCompressedTexSubImage2D(target, level, 0, 0, data.Width, data.Height, image.Format, static_cast<int>(data.Size), data.Data);
+                else
+                    glCompressedTexImage2D(target, level, image.Format, data.Width, data.Height, 0, static_cast<int>(data.Size), data.Data);
+                m_CompressedBytes += data.Size;
+            }
+
+            if (!HasTextureStorage())
+                glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, m_LevelCount - 1);
+        }
+
+        void Upload(const Image& image, int maxLevelCount = 0)
+        {
+            Allocate(image.Width, image.Height, image.Channels, 1, maxLevelCount);
+            UploadLevel(image, 0);
+
+            std::vector<Image> mips = Image::GenerateMipChain(image, m_LevelCount);
+            for (size_t i = 0; i < mips.size(); ++i)
+                UploadLevel(mips[i], static_cast<int>(i) + 1);
+        }
+
+        /// <summary>
+        /// Uploads same-sized images as layers, slices or cubemap faces.
+        /// </summary>
+        void UploadLayers(const std::vector<Image>& images)
+        {
+            Allocate(images[0].Width, images[0].Height, images[0].Channels, static_cast<int>(images.size()));
+
+            for (int layer = 0; layer < m_Depth; ++layer)
+                UploadLevel(images[layer], 0, layer);
+
+            if (m_LevelCount == 1)
+                return;
+
+            // Mips of 3D texture mix neighbouring slices, leave them to driver.
+            if (m_Type == TextureType::Texture3D)
+            {
+                glGenerateMipmap((unsigned int)m_Type);
+                return;
+            }
+
+            // Layers run in parallel, Downsample inside them stays on layer's thread.
+            std::vector<std::vector<Image>> mips(images.size());
+            Parallel::For(images.size(), [&](size_t layer) { mips[layer] = Image::GenerateMipChain(images[layer], m_LevelCount); });
+
+            for (int layer = 0; layer < m_Depth; ++layer)
+            {
+                for (size_t i = 0; i < mips[layer].size(); ++i)
+                    UploadLevel(mips[layer][i], static_cast<int>(i) + 1, layer);
+            }
+        }
+
+    public:
+        /// <param name="path">path to texture file. .dds and .ktx2 files are uploaded compressed with their own mip levels.</param>
+        /// <param name="type">See TextureType struct.</param>
+        /// <param name="flipY">should flip texture vertically? (ignored for .dds/.ktx2, bake them flipped instead)</param>
+        Texture(const std::string& path, TextureType type, bool flipY, WrapMode wrapS, WrapMode wrapT, WrapMode wrapR, MinFilter minFilter, MagFilter magFilter)
+            : Texture(type, wrapS, wrapT, wrapR, minFilter, magFilter)
+        {
+            if (CompressedImage::IsCompressedFile(path))
+            {
+                CompressedImage compressed = CompressedImage::Load(path);
+                if (!compressed.IsValid())
+                {
+                    Log("Warning! << Failed to load compressed texture (missing file or unsupported format): " << path);
+                }
+                else if (m_Type != TextureType::Texture2D)
+                {
+                    Log("Warning! << Compressed textures are supported only as Texture2D: " << path);
+                }
+                else
+                {
+                    UploadCompressed(compressed);
+                }
+                return;
+            }
+
+            Image image = Image::Load(path, flipY);
+            if (!image.IsValid())
+            {
+                Log("Warning! << Failed to load texture from path: " << path);
+            }
+            else if (m_Type == TextureType::Texture2DArray || m_Type == TextureType::Texture3D)
+            {
+                UploadLayers({ image });
+            }
+            else
+            {
+                Upload(image);
+            }
+        }
+
+        /// <summary>
+        /// <para>Builds Texture2DArray (one layer per path), Texture3D (one slice per path)</para>
+        /// <para>or TextureCubemap (six faces in order +X, -X, +Y, -Y, +Z, -Z). Images are decoded in parallel and must have same size.</para>
+        /// </summary>
+        /// <param name="paths">Paths to layer, slice or face files.</param>
+        /// <param name="type">Texture2DArray, Texture3D or TextureCubemap</param>
+        Texture(const std::vector<std::string>& paths, TextureType type, bool flipY, WrapMode wrapS, WrapMode wrapT, WrapMode wrapR, MinFilter minFilter, MagFilter magFilter)
+            : Texture(type, wrapS, wrapT, wrapR, minFilter, magFilter)
+        {
+            if (m_Type != TextureType::Texture2DArray && m_Type != TextureType::Texture3D && m_Type != TextureType::TextureCubemap)
+            {
+                Log("Warning! << Texture from several files must be Texture2DArray, Texture3D or TextureCubemap.");
+                return;
+            }
+
+            if (m_Type == TextureType::TextureCubemap && paths.size() != 6)
+            {
+                Log("Warning! << Cubemap needs 6 faces, got " << paths.size());
+                return;
+            }
+
+            std::vector<Image> images = Image::LoadMany(paths, flipY);
+
+            for (size_t i = 0; i < images.size(); ++i)
+            {
+                if (!images[i].IsValid())
+                {
+                    Log("Warning! << Failed to load texture from path: " << paths[i]);
+                    return;
+                }
+
+                if (images[i].Width != images[0].Width || images[i].Height != images[0].Height || images[i].Channels != images[0].Channels)
+                {
+                    Log("Warning! << Texture layer has different size or channel count than first one: " << paths[i]);
+                    return;
+                }
+
+                // glTexStorage2D/glTexImage2D reject non-square cubemap faces.
+                if (m_Type == TextureType::TextureCubemap && images[i].Width != images[i].Height)
+                {
+                    Log("Warning! << Cubemap face is not square (" << images[i].Width << "x" << images[i].Height << "): " << paths[i]);
+                    return;
+                }
+            }
+
+            if (!images.empty())
+                UploadLayers(images);
+        }
+
+        /// <param name="image">Decoded image, e.g. from Image::Load() or TextureAtlas</param>
+        /// <param name="maxLevelCount">Limit of mip levels (e.g. atlas pages whose gutters only cover few levels), 0 = full chain</param>
+        Texture(const Image& image, TextureType type, WrapMode wrapS, WrapMode wrapT, WrapMode wrapR, MinFilter minFilter, MagFilter magFilter, int maxLevelCount = 0)
+            : Texture(type, wrapS, wrapT, wrapR, minFilter, magFilter)
+        {
+            if (image.IsValid())
+                Upload(image, maxLevelCount);
+        }
+
+        ~Texture()
+        {
+            Delete();
+        }
+
+        Texture(Texture&& other) noexcept
+            : m_ID(other.m_ID), m_Width(other.m_Width), m_Height(other.m_Height), m_Channels(other.m_Channels), m_Depth(other.m_Depth),
+              m_LevelCount(other.m_LevelCount), m_CompressedBytes(other.m_CompressedBytes), m_UseMipmaps(other.m_UseMipmaps), m_Type(other.m_Type)
+        {
+            other.m_ID = 0;
+        }
+
+        Texture& operator=(Texture&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Delete();
+                m_ID = other.m_ID;
+                m_Width = other.m_Width;
+                m_Height = other.m_Height;
+                m_Channels = other.m_Channels;
+                m_Depth = other.m_Depth;
+                m_LevelCount = other.m_LevelCount;
+                m_CompressedBytes = other.m_CompressedBytes;
+                m_UseMipmaps = other.m_UseMipmaps;
+                m_Type = other.m_Type;
+                other.m_ID = 0;
+            }
+            return *this;
+        }
+
+        Texture(const Texture&) = delete;
+        Texture& operator=(const Texture&) = delete;
+
+        /// <summary>
+        /// Binds texture to unit. Skips GL calls when texture is already bound there, so Unbind() between draws is not needed.
+        /// </summary>
+        void Bind(unsigned int slot = 0) const
+        {
+            if (slot < TrackedUnitCount && s_BoundTextures[slot] == m_ID)
+                return;
+
+            if (s_ActiveUnit != slot)
+            {
+                glActiveTexture(GL_TEXTURE0 + slot);
+                s_ActiveUnit = slot;
+            }
+
+            glBindTexture((unsigned int)m_Type, m_ID);
+            if (slot < TrackedUnitCount)
+                s_BoundTextures[slot] = m_ID;
+        }
+
+        /// <summary>
+        /// Unbinds texture target of active unit.
+        /// </summary>
+        void Unbind() const
+        {
+            glBindTexture((unsigned int)m_Type, 0);
+            if (s_ActiveUnit < TrackedUnitCount)
+                s_BoundTextures[s_ActiveUnit] = 0;
+        }
+
+        /// <summary>
+        /// Call this if you called glActiveTexture/glBindTexture yourself, so next Bind() binds again.
+        /// </summary>
+        static void InvalidateBindings()
+        {
+            s_BoundTextures.fill(~0u);
+            s_ActiveUnit = ~0u;
+        }
+
+        unsigned int GetID() const
+        {
+            return m_ID;
+        }
+
+        /// <returns>False if loading failed and texture has no storage</returns>
+        bool IsValid() const
+        {
+            return m_ID != 0 && m_Width > 0;
+        }
+
+        int GetWidth() const
+        {
+            return m_Width;
+        }
+
+        int GetHeight() const
+        {
+            return m_Height;
+        }
+
+        int GetChannels() const
+        {
+            return m_Channels;
+        }
+
+        /// <returns>Layers of array texture, slices of 3D texture, 6 for cubemap, otherwise 1</returns>
+        int GetDepth() const
+        {
+            return m_Depth;
+        }
+
+        /// <returns>Estimated GPU memory of texture in bytes, mip chain included</returns>
+        size_t GetByteSize() const
+        {
+            if (m_CompressedBytes != 0)
+                return m_CompressedBytes;
+
+            size_t bytes = 0;
+            int width = m_Width, height = m_Height, depth = m_Depth;
+            for (int level = 0; level < m_LevelCount; ++level)
+            {
+                bytes += static_cast<size_t>(width) * height * depth * m_Channels;
+
+                width = std::max(width / 2, 1);
+                height = std::max(height / 2, 1);
+
+                // Only 3D textures shrink in depth, array layers and cube faces stay.
+                if (m_Type == TextureType::Texture3D)
+                    depth = std::max(depth / 2, 1);
+            }
+            return bytes;
+        }
+    };
+
+    /// <summary>
+    /// <para>Shares textures loaded with same path and parameters. Get() loads texture only on first request.</para>
+    /// <para>Cache keeps one reference, Purge() releases textures nobody else uses.</para>
+    /// </summary>
+    class TextureCache
+    {
+    public:
+        struct Key
+        {
+            std::string Path;
+            TextureType Type;
+            bool FlipY;
+            WrapMode WrapS, WrapT, WrapR;
+            MinFilter Min;
+            MagFilter Mag;
+
+            bool operator<(const Key& other) const
+            {
+                return std::tie(Path, Type, FlipY, WrapS, WrapT, WrapR, Min, Mag)
+                    < std::tie(other.Path, other.Type, other.FlipY, other.WrapS, other.WrapT, other.WrapR, other.Min, other.Mag);
+            }
+        };
+
+        struct EntryInfo
+        {
+            std::string Path;
+            long References;    // Users outside of cache
+            size_t Bytes;
+        };
+
+    private:
+        std::map<Key, std::shared_ptr<Texture>> m_Textures;
+
+    public:
+        /// <summary>
+        /// Same arguments as Texture constructor.
+        /// </summary>
+        /// <returns>Shared texture, loaded now if this key was not requested before. Failed loads are not cached, next Get() tries again.</returns>
+        std::shared_ptr<Texture> Get(const std::string& path, TextureType type, bool flipY, WrapMode wrapS, WrapMode wrapT, WrapMode wrapR, MinFilter minFilter, MagFilter magFilter)
+        {
+            Key key{ std::filesystem::absolute(path).lexically_normal().string(), type, flipY, wrapS, wrapT, wrapR, minFilter, magFilter };
+
+            auto textureIter = m_Textures.find(key);
+            if (textureIter != m_Textures.end())
+                return textureIter->second;
+
+            std::shared_ptr<Texture> texture = std::make_shared<Texture>(path, type, flipY, wrapS, wrapT, wrapR, minFilter, magFilter);
+            if (texture->IsValid())
+                m_Textures.emplace(std::move(key), texture);
+
+            return texture;
+        }
+
+        /// <summary>
+        /// Releases textures that are referenced only by cache.
+        /// </summary>
+        /// <returns>Number of released textures</returns>
+        size_t Purge()
+        {
+            size_t released = 0;
+            for (auto textureIter = m_Textures.begin(); textureIter != m_Textures.end(); )
+            {
+                if (textureIter->second.use_count() == 1)
+                {
+                    textureIter = m_Textures.erase(textureIter);
+                    ++released;
+                }
+                else
+                {
+                    ++textureIter;
+                }
+            }
+            return released;
+        }
+
+        /// <summary>
+        /// Releases all textures. Users keep theirs alive, but later Get() loads new copy.
+        /// </summary>
+        void Clear()
+        {
+            m_Textures.clear();
+        }
+
+        size_t GetTextureCount() const
+        {
+            return m_Textures.size();
+        }
+
+        /// <returns>Estimated GPU memory of all cached textures</returns>
+        size_t GetResidentBytes() const
+        {
+            size_t bytes = 0;
+            for (const auto& texture : m_Textures)
+                bytes += texture.second->GetByteSize();
+            return bytes;
+        }
+
+        /// <returns>Path, reference count and size of every cached texture</returns>
+        std::vector<EntryInfo> GetEntries() const
+        {
+            std::vector<EntryInfo> entries;
+            entries.reserve(m_Textures.size());
+            for (const auto& texture : m_Textures)
+                entries.push_back({ texture.first.Path, texture.second.use_count() - 1, texture.second->GetByteSize() });
+            return entries;
+        }
+    };
+
+    /// <summary>
+    /// Skyline bottom-left rectangle packer. Keeps only top outline of packed rectangles, so it is fast and good for sprites.
+    /// </summary>
+    class SkylinePacker
+    {
+    private:
+        struct Segment
+        {
+            int X, Y, Width;
+        };
+
+        int m_Width = 0;
+        int m_Height = 0;
+        std::vector<Segment> m_Skyline;
+
+    public:
+        SkylinePacker(int width, int height)
+            : m_Width(width), m_Height(height)
+        {
+            m_Skyline.push_back({ 0, 0, width });
+        }
+
+        /// <returns>False if rectangle does not fit</returns>
+        bool Insert(int width, int height, int& x, int& y)
+        {
+            int bestIndex = -1, bestY = INT32_MAX, bestWidth = INT32_MAX;
+
+            for (size_t i = 0; i < m_Skyline.size(); ++i)
+            {
+                int top = 0;
+                if (!Fits(i, width, height, top))
+                    continue;
+
+                // Lowest position first, narrowest segment breaks ties (less wasted space).
+                if (top < bestY || (top == bestY && m_Skyline[i].Width < bestWidth))
+                {
+                    bestIndex = static_cast<int>(i);
+                    bestY = top;
+                    bestWidth = m_Skyline[i].Width;
+                }
+            }
+
+            if (bestIndex < 0)
+                return false;
+
+            x = m_Skyline[bestIndex].X;
+            y = bestY;
+            AddSegment(static_cast<size_t>(bestIndex), x, y + height, width);
+            return true;
+        }
+
+    private:
+        /// <summary>
+        /// Checks if rectangle placed at left edge of segment fits, top = height it would rest on.
+        /// </summary>
+        bool Fits(size_t index, int width, int height, int& top) const
+        {
+            int x = m_Skyline[index].X;
+            if (x + width > m_Width)
+                return false;
+
+            top = 0;
+            int remaining = width;
+            for (size_t i = index; remaining > 0; ++i)
+            {
+                top = std::max(top, m_Skyline[i].Y);
+                if (top + height > m_Height)
+                    return false;
+                remaining -= m_Skyline[i].Width;
+            }
+            return true;
+        }
+
+        void AddSegment(size_t index, int x, int y, int width)
+        {
+            m_Skyline.insert(m_Skyline.begin() + index, { x, y, width });
+
+            // Shrink or remove segments now covered by new one.
+            for (size_t i = index + 1; i < m_Skyline.size(); )
+            {
+                Segment& segment = m_Skyline[i];
+                int covered = x + width - segment.X;
+                if (covered <= 0)
+                    break;
+
+                if (covered < segment.Width)
+                {
+                    segment.X += covered;
+                    segment.Width -= covered;
+                    break;
+                }
+
+                m_Skyline.erase(m_Skyline.begin() + i);
+            }
+
+            // Merge neighbours at same height.
+            for (size_t i = 0; i + 1 < m_Skyline.size(); )
+            {
+                if (m_Skyline[i].Y == m_Skyline[i + 1].Y)
+                {
+                    m_Skyline[i].Width += m_Skyline[i + 1].Width;
+                    m_Skyline.erase(m_Skyline.begin() + i + 1);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+    };
+
+    /// <summary>
+    /// Place of one image in TextureAtlas.
+    /// </summary>
+    struct AtlasRegion
+    {
+        int Page = 0;
+        int X = 0, Y = 0, Width = 0, Height = 0;    // Pixels in page, gutter excluded
+        glm::vec2 UVMin = glm::vec2(0.0f);
+        glm::vec2 UVMax = glm::vec2(0.0f);
+
+        /// <returns>Sprite UV (0..1) mapped into atlas page</returns>
+        glm::vec2 Map(const glm::vec2& uv) const
+        {
+            return UVMin + uv * (UVMax - UVMin);
+        }
+    };
+
+    /// <summary>
+    /// <para>Packs many small images into few RGBA textures (pages), so sprites can share one texture binding.</para>
+    /// <para>Each image gets gutter of repeated edge pixels, so filtering and lower mips do not bleed neighbours in.</para>
+    /// </summary>
+    class TextureAtlas
+    {
+    private:
+        struct PendingImage
+        {
+            std::string Name;
+            Image Source;
+        };
+
+        int m_PageSize = 0;
+        int m_Gutter = 0;
+        int m_MaxMipLevel = 0;  // Last level gutters protect, pages are clamped to it
+        int m_Alignment = 1;    // 1 << m_MaxMipLevel, slots start and end on it
+
+        std::vector<PendingImage> m_Pending;
+        std::map<std::string, AtlasRegion> m_Regions;
+        std::vector<std::shared_ptr<Texture>> m_Pages;
+
+    public:
+        /// <summary>
+        /// <para>Slots are aligned to 2^maxMipLevel pixels (maxMipLevel = floor(log2(gutter))) and pages get only levels 0 to maxMipLevel.</para>
+        /// <para>Every slot then stays its own block on each of those levels, so images never bleed into neighbours.</para>
+        /// </summary>
+        /// <param name="pageSize">Width and height of each page texture</param>
+        /// <param name="gutter">Pixels of repeated edge around each image, 4 keeps 3 mip levels (0, 1, 2) bleed-free</param>
+        TextureAtlas(int pageSize = 2048, int gutter = 4)
+            : m_PageSize(pageSize), m_Gutter(std::max(gutter, 0))
+        {
+            while ((2 << m_MaxMipLevel) <= m_Gutter)
+                ++m_MaxMipLevel;
+            m_Alignment = 1 << m_MaxMipLevel;
+        }
+
+        /// <summary>
+        /// Adds image to be packed by next Build().
+        /// </summary>
+        void Add(const std::string& name, Image image)
+        {
+            if (!image.IsValid())
+            {
+                Log("Warning! << Atlas image is empty: " << name);
+                return;
+            }
+            m_Pending.push_back({ name, std::move(image) });
+        }
+
+        /// <returns>False if file could not be loaded</returns>
+        bool Add(const std::string& name, const std::string& path, bool flipY)
+        {
+            Image image = Image::Load(path, flipY);
+            if (!image.IsValid())
+            {
+                Log("Warning! << Failed to load texture from path: " << path);
+                return false;
+            }
+            Add(name, std::move(image));
+            return true;
+        }
+
+        /// <summary>
+        /// Packs all added images into new pages. Previous regions and pages are replaced.
+        /// </summary>
+        void Build(MinFilter minFilter = MinFilter::LinearMipmapLinear, MagFilter magFilter = MagFilter::Linear)
+        {
+            m_Regions.clear();
+            m_Pages.clear();
+
+            // Tallest first packs much tighter on skyline.
+            std::vector<const PendingImage*> order;
+            for (const PendingImage& pending : m_Pending)
+                order.push_back(&pending);
+            std::stable_sort(order.begin(), order.end(),
+                [](const PendingImage* a, const PendingImage* b) { return a->Source.Height > b->Source.Height; });
+
+            std::vector<SkylinePacker> packers;
+            std::vector<Image> pages;
+
+            for (const PendingImage* pending : order)
+            {
+                const Image& source = pending->Source;
+                int width = AlignUp(source.Width + m_Gutter * 2);
+                int height = AlignUp(source.Height + m_Gutter * 2);
+                if (width > m_PageSize || height > m_PageSize)
+                {
+                    Log("Warning! << Image does not fit into atlas page: " << pending->Name);
+                    continue;
+                }
+
+                int x = 0, y = 0;
+                size_t page = 0;
+                while (page < packers.size() && !packers[page].Insert(width, height, x, y))
+                    ++page;
+
+                if (page == packers.size())
+                {
+                    packers.emplace_back(m_PageSize, m_PageSize);
+                    packers.back().Insert(width, height, x, y);
+
+                    Image pageImage;
+                    pageImage.Width = m_PageSize;
+                    pageImage.Height = m_PageSize;
+                    pageImage.Channels = 4;
+                    pageImage.Pixels.assign(static_cast<size_t>(m_PageSize) * m_PageSize * 4, 0);
+                    pages.push_back(std::move(pageImage));
+                }
+
+                Blit(source, pages[page], x, y, width, height);
+
+                AtlasRegion region;
+                region.Page = static_cast<int>(page);
+                region.X = x + m_Gutter;
+                region.Y = y + m_Gutter;
+                region.Width = source.Width;
+                region.Height = source.Height;
+                region.UVMin = glm::vec2(region.X, region.Y) / static_cast<float>(m_PageSize);
+                region.UVMax = glm::vec2(region.X + region.Width, region.Y + region.Height) / static_cast<float>(m_PageSize);
+                m_Regions[pending->Name] = region;
+            }
+
+            for (const Image& page : pages)
+                m_Pages.push_back(std::make_shared<Texture>(page, TextureType::Texture2D, WrapMode::ClampToEdge, WrapMode::ClampToEdge, WrapMode::ClampToEdge, minFilter, magFilter, m_MaxMipLevel + 1));
+
+            m_Pending.clear();
+        }
+
+        /// <returns>Region of image or nullptr if name was not packed</returns>
+        const AtlasRegion* GetRegion(const std::string& name) const
+        {
+            auto regionIter = m_Regions.find(name);
+            return regionIter != m_Regions.end() ? &regionIter->second : nullptr;
+        }
+
+        std::shared_ptr<Texture> GetPage(int page) const
+        {
+            return m_Pages.at(static_cast<size_t>(page));
+        }
+
+        size_t GetPageCount() const
+        {
+            return m_Pages.size();
+        }
+
+    private:
+        int AlignUp(int size) const
+        {
+            return (size + m_Alignment - 1) / m_Alignment * m_Alignment;
+        }
+
+        /// <summary>
+        /// Copies image converted to RGBA into page at (x, y) + gutter, then extends edge pixels over rest of width x height slot.
+        /// </summary>
+        void Blit(const Image& source, Image& page, int x, int y, int width, int height) const
+        {
+            for (int row = 0; row < height; ++row)
+            {
+                int sourceRow = std::clamp(row - m_Gutter, 0, source.Height - 1);
+                const unsigned char* sourcePixels = source.Pixels.data() + sourceRow * source.GetRowSize();
+                unsigned char* pagePixels = page.Pixels.data() + (static_cast<size_t>(y + row) * page.Width + x) * 4;
+
+                for (int column = 0; column < width; ++column)
+                {
+                    int sourceColumn = std::clamp(column - m_Gutter, 0, source.Width - 1);
+                    const unsigned char* pixel = sourcePixels + sourceColumn * source.Channels;
+                    unsigned char* out = pagePixels + column * 4;
+
+                    switch (source.Channels)
+                    {
+                    case 1: out[0] = out[1] = out[2] = pixel[0]; out[3] = 255; break;
+                    case 2: out[0] = out[1] = out[2] = pixel[0]; out[3] = pixel[1]; break;
+                    case 3: out[0] = pixel[0]; out[1] = pixel[1]; out[2] = pixel[2]; out[3] = 255; break;
+                    default: std::memcpy(out, pixel, 4); break;
+                    }
+                }
+            }
+        }
+    };
+
+    /// <summary>
+    /// Result of TextureLoader::Load(). Becomes ready when texture is fully uploaded to GPU.
+    /// </summary>
+    class TextureHandle
+    {
+        friend class TextureLoader;
+
+    private:
+        enum class State { Pending, Ready, Failed };
+
+        std::shared_ptr<Texture> m_Texture;
+        std::string m_Path;
+        State m_State = State::Pending;
+
+    public:
+        bool IsReady() const
+        {
+            return m_State == State::Ready;
+        }
+
+        bool IsFailed() const
+        {
+            return m_State == State::Failed;
+        }
+
+        /// <returns>Texture when ready, nullptr before that (and on failure)</returns>
+        std::shared_ptr<Texture> Get() const
+        {
+            return IsReady() ? m_Texture : nullptr;
+        }
+
+        const std::string& GetPath() const
+        {
+            return m_Path;
+        }
+    };
+
+    /// <summary>
+    /// <para>Loads 2D textures in background. Worker threads decode images, Update() on GL thread uploads them</para>
+    /// <para>through pixel buffer object, at most maxUploadBytes per call, so main loop never stalls on big levels.</para>
+    /// </summary>
+    class TextureLoader
+    {
+    private:
+        struct Job
+        {
+            std::shared_ptr<TextureHandle> Handle;
+            std::string Path;
+            bool FlipY = false;
+            int LevelCount = 1;     // 1 = no mipmaps, otherwise full chain
+            Image Decoded;
+            std::vector<Image> Mips;
+
+            /// <returns>Image of mip level, level 0 is decoded image</returns>
+            const Image& GetLevel(int level) const
+            {
+                return level == 0 ? Decoded : Mips[static_cast<size_t>(level) - 1];
+            }
+        };
+
+        std::vector<std::thread> m_Workers;
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        bool m_Stop = false;
+
+        std::deque<Job> m_DecodeQueue;  // Guarded by m_Mutex
+        std::deque<Job> m_UploadQueue;  // Guarded by m_Mutex
+
+        // GL thread only.
+        Job m_Uploading;
+        bool m_HasUpload = false;
+        int m_UploadLevel = 0;
+        int m_UploadedRows = 0;
+        unsigned int m_PBO = 0;
+        size_t m_PBOSize = 0;
+        size_t m_PendingCount = 0;
+        int m_MapFailures = 0;      // Consecutive failed maps of current chunk
+
+        static constexpr int MaxMapFailures = 3;
+
+    public:
+        /// <param name="threadCount">Decode threads, 0 = hardware threads - 1</param>
+        explicit TextureLoader(unsigned int threadCount = 0)
+        {
+            if (threadCount == 0)
+            {
+                // hardware_concurrency() may return 0 when unknown
+                unsigned int hardwareThreads = std::thread::hardware_concurrency();
+                threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+            }
+
+            for (unsigned int i = 0; i < threadCount; ++i)
+                m_Workers.emplace_back(&TextureLoader::WorkerLoop, this);
+        }
+
+        ~TextureLoader()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stop = true;
+            }
+            m_Condition.notify_all();
+
+            for (std::thread& worker : m_Workers)
+                worker.join();
+
+            if (m_PBO != 0)
+                glDeleteBuffers(1, &m_PBO);
+        }
+
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+
+        /// <summary>
+        /// Queues texture for loading. Must be called on GL thread (texture object is created here).
+        /// </summary>
+        /// <returns>Handle, poll IsReady() or wait with Flush()</returns>
+        std::shared_ptr<TextureHandle> Load(const std::string& path, TextureType type, bool flipY, WrapMode wrapS, WrapMode wrapT, WrapMode wrapR, MinFilter minFilter, MagFilter magFilter)
+        {
+            std::shared_ptr<TextureHandle> handle = std::make_shared<TextureHandle>();
+            handle->m_Path = path;
+
+            // Compressed containers need no decoding, mapped levels are uploaded right away.
+            if (CompressedImage::IsCompressedFile(path))
+            {
+                handle->m_Texture = std::make_shared<Texture>(path, type, flipY, wrapS, wrapT, wrapR, minFilter, magFilter);
+                handle->m_State = handle->m_Texture->m_LevelCount > 0 ? TextureHandle::State::Ready : TextureHandle::State::Failed;
+                return handle;
+            }
+
+            handle->m_Texture = std::shared_ptr<Texture>(new Texture(type, wrapS, wrapT, wrapR, minFilter, magFilter));
+
+            if (type != TextureType::Texture2D)
+            {
+                Log("Warning! << TextureLoader supports only Texture2D: " << path);
+                handle->m_State = TextureHandle::State::Failed;
+                return handle;
+            }
+
+            Job job;
+            job.Handle = handle;
+            job.Path = path;
+            job.FlipY = flipY;
+            job.LevelCount = handle->m_Texture->m_UseMipmaps ? 0 : 1;   // 0 = worker computes full chain
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_DecodeQueue.push_back(std::move(job));
+            }
+            m_Condition.notify_one();
+
+            ++m_PendingCount;
+            return handle;
+        }
+
+        /// <summary>
+        /// Call once per frame on GL thread. Uploads decoded images, finished textures become ready.
+        /// </summary>
+        /// <param name="maxUploadBytes">Upload budget of this call (at least one row is always uploaded)</param>
+        /// <returns>Number of textures that became ready</returns>
+        size_t Update(size_t maxUploadBytes = 4 * 1024 * 1024)
+        {
+            size_t finished = 0;
+            size_t budget = maxUploadBytes;
+
+            while (budget > 0)
+            {
+                if (!m_HasUpload && !BeginUpload())
+                    break;
+
+                size_t uploaded = UploadRows(budget);
+                if (uploaded == 0)
+                    break;      // Chunk is retried next call (or texture failed)
+
+                budget -= std::min(budget, uploaded);
+
+                if (m_UploadedRows == m_Uploading.GetLevel(m_UploadLevel).Height)
+                {
+                    m_UploadedRows = 0;
+                    if (++m_UploadLevel == m_Uploading.LevelCount)
+                    {
+                        EndUpload();
+                        ++finished;
+                    }
+                }
+            }
+
+            return finished;
+        }
+
+        /// <summary>
+        /// Blocks until every queued texture is ready (e.g. behind loading screen).
+        /// </summary>
+        void Flush()
+        {
+            for (;;)
+            {
+                // Unlimited budget drains upload queue, so waiting for next decoded image is safe.
+                Update(SIZE_MAX);
+                if (m_PendingCount == 0)
+                    return;
+
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                // Chunk whose map failed is retried right away, without waiting for worker.
+                m_Condition.wait(lock, [this]() { return m_HasUpload || !m_UploadQueue.empty(); });
+            }
+        }
+
+        /// <returns>Textures queued but not ready yet</returns>
+        size_t GetPendingCount() const
+        {
+            return m_PendingCount;
+        }
+
+    private:
+        void WorkerLoop()
+        {
+            // Loader already runs one decode per worker, don't let mip generation start more threads.
+            Parallel::MarkSerialThread();
+
+            for (;;)
+            {
+                Job job;
+
+                {
+                    std::unique_lock<std::mutex> lock(m_Mutex);
+                    m_Condition.wait(lock, [this]() { return m_Stop || !m_DecodeQueue.empty(); });
+                    if (m_Stop)
+                        return;
+
+                    job = std::move(m_DecodeQueue.front());
+                    m_DecodeQueue.pop_front();
+                }
+
+                job.Decoded = Image::Load(job.Path, job.FlipY);
+
+                // Mip chain is built here too, so GL thread only copies bytes.
+                if (job.Decoded.IsValid())
+                {
+                    if (job.LevelCount == 0)
+                        job.LevelCount = Texture::GetMipLevelCount(job.Decoded.Width, job.Decoded.Height);
+                    job.Mips = Image::GenerateMipChain(job.Decoded, job.LevelCount);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_UploadQueue.push_back(std::move(job));
+                }
+                // Wakes Flush() too, so all waiters have to be notified.
+                m_Condition.notify_all();
+            }
+        }
+
+        /// <returns>False if no decoded image is waiting</returns>
+        bool BeginUpload()
+        {
+            for (;;)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    if (m_UploadQueue.empty())
+                        return false;
+
+                    m_Uploading = std::move(m_UploadQueue.front());
+                    m_UploadQueue.pop_front();
+                }
+
+                if (m_Uploading.Decoded.IsValid())
+                    break;
+
+                Log("Warning! << Failed to load texture from path: " << m_Uploading.Path);
+                m_Uploading.Handle->m_State = TextureHandle::State::Failed;
+                m_Uploading = Job();
+                --m_PendingCount;
+            }
+
+            const Image& image = m_Uploading.Decoded;
+            Texture& texture = *m_Uploading.Handle->m_Texture;
+            texture.BindForUpdate();
+            texture.Allocate(image.Width, image.Height, image.Channels);
+
+            m_HasUpload = true;
+            m_UploadLevel = 0;
+            m_UploadedRows = 0;
+            m_MapFailures = 0;
+            return true;
+        }
+
+        /// <summary>
+        /// Rows are counted only after they reached texture. Chunk whose buffer can't be mapped is kept for next call,
+        /// after MaxMapFailures tries in a row texture is marked failed.
+        /// </summary>
+        /// <returns>Bytes uploaded, 0 if nothing was uploaded</returns>
+        size_t UploadRows(size_t budget)
+        {
+            const Image& image = m_Uploading.GetLevel(m_UploadLevel);
+            Texture& texture = *m_Uploading.Handle->m_Texture;
+
+            size_t rowSize = image.GetRowSize();
+            int rows = static_cast<int>(std::min<size_t>(std::max<size_t>(budget / rowSize, 1), static_cast<size_t>(image.Height - m_UploadedRows)));
+            size_t size = rows * rowSize;
+
+            if (m_PBO == 0)
+                glGenBuffers(1, &m_PBO);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PBO);
+
+            // Orphan buffer every chunk, driver hands out fresh memory instead of waiting for previous transfer.
+            m_PBOSize = std::max(m_PBOSize, size);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, m_PBOSize, nullptr, GL_STREAM_DRAW);
+
+            void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (mapped == nullptr)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+                if (++m_MapFailures < MaxMapFailures)
+                    return 0;
+
+                Log("Warning! << Failed to map texture upload buffer, texture is incomplete: " << m_Uploading.Path);
+                m_Uploading.Handle->m_State = TextureHandle::State::Failed;
+                m_Uploading = Job();
+                m_HasUpload = false;
+                --m_PendingCount;
+                return 0;
+            }
+
+            std::memcpy(mapped, image.Pixels.data() + m_UploadedRows * rowSize, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+            texture.BindForUpdate();
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D((unsigned int)texture.m_Type, m_UploadLevel, 0, m_UploadedRows, image.Width, rows, Texture::GetFormat(image.Channels), GL_UNSIGNED_BYTE, nullptr);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+            m_MapFailures = 0;
+            m_UploadedRows += rows;
+            return size;
+        }
+
+        void EndUpload()
+        {
+            m_Uploading.Handle->m_State = TextureHandle::State::Ready;
+            m_Uploading = Job();
+            m_HasUpload = false;
+            --m_PendingCount;
+        }
+    };
+
+#ifdef GL_ARB_bindless_texture
+    /// <summary>
+    /// <para>Table of bindless texture handles (GL_ARB_bindless_texture) in shader storage buffer. Textures are made</para>
+    /// <para>resident once, shaders index table, so drawing objects with different textures needs no binds at all.</para>
+    /// <para>GLSL: #extension GL_ARB_bindless_texture : require</para>
+    /// <para>      layout(std430, binding = 0) readonly buffer BindlessTextures { sampler2D textures[]; };</para>
+    /// </summary>
+    class BindlessTextureTable
+    {
+    private:
+        unsigned int m_ID = 0;
+        std::vector<uint64_t> m_Handles;
+        std::vector<std::shared_ptr<Texture>> m_Textures;   // Keeps resident textures alive
+        size_t m_UploadedCount = 0;
+
+    public:
+        /// <returns>True if driver exposes bindless textures and shader storage buffers</returns>
+        static bool IsSupported()
+        {
+            return GLAD_GL_ARB_bindless_texture != 0 && GLAD_GL_VERSION_4_3 != 0;
+        }
+
+        BindlessTextureTable()
+        {
+            glGenBuffers(1, &m_ID);
+        }
+
+        ~BindlessTextureTable()
+        {
+            for (uint64_t handle : m_Handles)
+                glMakeTextureHandleNonResidentARB(handle);
+            glDeleteBuffers(1, &m_ID);
+        }
+
+        BindlessTextureTable(const BindlessTextureTable&) = delete;
+        BindlessTextureTable& operator=(const BindlessTextureTable&) = delete;
+
+        /// <summary>
+        /// Makes texture resident. Its parameters cannot be changed afterwards (GL rule for textures with handles).
+        /// </summary>
+        /// <returns>Index of texture in table, pass it to shader (e.g. as uniform or vertex attribute)</returns>
+        int Add(const std::shared_ptr<Texture>& texture)
+        {
+            for (size_t i = 0; i < m_Textures.size(); ++i)
+            {
+                if (m_Textures[i] == texture)
+                    return static_cast<int>(i);
+            }
+
+            uint64_t handle = glGetTextureHandleARB(texture->GetID());
+            glMakeTextureHandleResidentARB(handle);
+
+            m_Handles.push_back(handle);
+            m_Textures.push_back(texture);
+            return static_cast<int>(m_Handles.size() - 1);
+        }
+
+        /// <summary>
+        /// Uploads new handles (if any) and binds table to shader storage binding point.
+        /// </summary>
+        void Bind(unsigned int binding = 0)
+        {
+            if (m_UploadedCount != m_Handles.size())
+            {
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ID);
+                glBufferData(GL_SHADER_STORAGE_BUFFER, m_Handles.size() * sizeof(uint64_t), m_Handles.data(), GL_STATIC_DRAW);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+                m_UploadedCount = m_Handles.size();
+            }
+
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, m_ID);
+        }
+
+        size_t GetTextureCount() const
+        {
+            return m_Handles.size();
+        }
+    };
+#endif
+
+    /// <summary>
+    /// <para>GL buffer with capacity separate from size. Capacity grows geometrically and keeps contents, so small size changes never reallocate.</para>
+    /// <para>Data is written through GL_COPY_WRITE_BUFFER, so updating element buffer never changes bound vertex array.</para>
+    /// </summary>
+    class BufferObject
+    {
+    protected:
+        unsigned int m_ID = 0;
+        BufferUsage m_Usage = BufferUsage::Empty;
+
+        size_t m_Size = 0;      // Bytes in use
+        size_t m_Capacity = 0;  // Bytes allocated
+
+        static inline uint64_t s_UploadedBytes = 0;
+
+        explicit BufferObject(BufferUsage usage)
+            : m_Usage(usage)
+        {
+            glGenBuffers(1, &m_ID);
+        }
+
+        ~BufferObject()
+        {
+            glDeleteBuffers(1, &m_ID);
+        }
+
+        BufferObject(BufferObject&& other) noexcept
+            : m_ID(other.m_ID), m_Usage(other.m_Usage), m_Size(other.m_Size), m_Capacity(other.m_Capacity)
+        {
+            other.m_ID = 0;
+            other.m_Usage = BufferUsage::Empty;
+            other.m_Size = 0;
+            other.m_Capacity = 0;
+        }
+
+        BufferObject& operator=(BufferObject&& other) noexcept
+        {
+            if (this != &other)
+            {
+                glDeleteBuffers(1, &m_ID);
+                m_ID = other.m_ID;
+                m_Usage = other.m_Usage;
+                m_Size = other.m_Size;
+                m_Capacity = other.m_Capacity;
+                other.m_ID = 0;
+                other.m_Size = 0;
+                other.m_Capacity = 0;
+            }
+            return *this;
+        }
+
+        BufferObject(const BufferObject&) = delete;
+        BufferObject& operator=(const BufferObject&) = delete;
+
+        /// <summary>
+        /// Allocates exactly bytes and uploads data. Used when buffer is created with known contents.
+        /// </summary>
+        void Allocate(const void* data, size_t bytes)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_ID);
+            glBufferData(GL_COPY_WRITE_BUFFER, bytes, data, GetUsage());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+            m_Size = bytes;
+            m_Capacity = bytes;
+            s_UploadedBytes += data != nullptr ? bytes : 0;
+        }
+
+        /// <summary>
+        /// Makes capacity at least bytes. Buffer name stays same, so vertex arrays referencing it stay valid.
+        /// </summary>
+        void Reserve(size_t bytes)
+        {
+            if (bytes <= m_Capacity)
+                return;
+
+            size_t capacity = std::max({ bytes, m_Capacity * 2, size_t(256) });
+
+            if (m_Size == 0)
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, m_ID);
+                glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GetUsage());
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+                m_Capacity = capacity;
+                return;
+            }
+
+            // Keep contents on GPU: copy out to temporary buffer, reallocate, copy back.
+            unsigned int temporary = 0;
+            glGenBuffers(1, &temporary);
+
+            glBindBuffer(GL_COPY_READ_BUFFER, m_ID);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, temporary);
+            glBufferData(GL_COPY_WRITE_BUFFER, m_Size, nullptr, GL_STREAM_COPY);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_Size);
+
+            glBindBuffer(GL_COPY_READ_BUFFER, temporary);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_ID);
+            glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GetUsage());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_Size);
+
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glDeleteBuffers(1, &temporary);
+
+            m_Capacity = capacity;
+        }
+
+        /// <summary>
+        /// Uploads bytes at offset, buffer grows if they end past current size.
+        /// </summary>
+        void Write(size_t offset, const void* data, size_t bytes)
+        {
+            if (bytes == 0)
+                return;
+
+            Reserve(offset + bytes);
+
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_ID);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+            m_Size = std::max(m_Size, offset + bytes);
+            s_UploadedBytes += bytes;
+        }
+
+        /// <summary>
+        /// Replaces whole contents. Growth orphans old storage instead of copying bytes that are about to be overwritten.
+        /// </summary>
+        void Replace(const void* data, size_t bytes)
+        {
+            if (bytes > m_Capacity)
+            {
+                size_t capacity = std::max({ bytes, m_Capacity * 2, size_t(256) });
+
+                glBindBuffer(GL_COPY_WRITE_BUFFER, m_ID);
+                glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GetUsage());
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+                m_Capacity = capacity;
+            }
+
+            m_Size = 0;
+            Write(0, data, bytes);
+            m_Size = bytes;
+        }
+
+        /// <summary>
+        /// Changes size without uploading. Growing keeps contents, new bytes are undefined until written.
+        /// </summary>
+        void SetSize(size_t bytes)
+        {
+            Reserve(bytes);
+            m_Size = bytes;
+        }
+
+        unsigned int GetUsage() const
+        {
+            // Default-constructed buffers had no usage, they are usually updated later.
+            return m_Usage == BufferUsage::Empty ? GL_DYNAMIC_DRAW : (unsigned int)m_Usage;
+        }
+
+    public:
+        unsigned int GetID() const
+        {
+            return m_ID;
+        }
+
+        size_t GetCapacity() const
+        {
+            return m_Capacity;
+        }
+
+        /// <returns>Bytes sent to GPU by all vertex/element buffers since last reset</returns>
+        static uint64_t GetUploadedBytes()
+        {
+            return s_UploadedBytes;
+        }
+
+        static void ResetUploadedBytes()
+        {
+            s_UploadedBytes = 0;
+        }
+    };
+
+    class VertexBufferObject : public BufferObject
+    {
+    private:
+        size_t m_VertexCount = 0;
+
+    public:
+        VertexBufferObject(const std::vector<Vertex>& vertices, BufferUsage _usage)
+            : BufferObject(_usage)
+        {
+            m_VertexCount = vertices.size();
+            Allocate(vertices.data(), vertices.size() * sizeof(Vertex));
+        }
+
+        VertexBufferObject()
+            : BufferObject(BufferUsage::Empty)
+        {
+        }
+
+        VertexBufferObject(VertexBufferObject&& other) noexcept
+            : BufferObject(std::move(other)), m_VertexCount(other.m_VertexCount)
+        {
+            other.m_VertexCount = 0;
+        }
+
+        VertexBufferObject& operator=(VertexBufferObject&& other) noexcept
+        {
+            if (this != &other)
+            {
+                BufferObject::operator=(std::move(other));
+                m_VertexCount = other.m_VertexCount;
+                other.m_VertexCount = 0;
+            }
+            return *this;
+        }
+
+        VertexBufferObject(const VertexBufferObject&) = delete;
+        VertexBufferObject& operator=(const VertexBufferObject&) = delete;
+
+        /// <summary>
+        /// Replaces all vertices. Reallocates only when capacity is exceeded.
+        /// </summary>
+        void UpdateVBO(const std::vector<Vertex>& vertices)
+        {
+            Replace(vertices.data(), vertices.size() * sizeof(Vertex));
+            m_VertexCount = vertices.size();
+        }
+
+        /// <summary>
+        /// Uploads count vertices starting at vertex first. Writing past end grows vertex count.
+        /// </summary>
+        void UpdateRange(size_t first, const Vertex* vertices, size_t count)
+        {
+            Write(first * sizeof(Vertex), vertices, count * sizeof(Vertex));
+            m_VertexCount = std::max(m_VertexCount, first + count);
+        }
+
+        /// <summary>
+        /// Changes vertex count without uploading (kept vertices stay on GPU).
+        /// </summary>
+        void SetVertexCount(size_t count)
+        {
+            SetSize(count * sizeof(Vertex));
+            m_VertexCount = count;
+        }
+
+        void Use() const
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+        }
+
+        void Unuse() const
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        size_t GetVertexCount() const
+        {
+            return m_VertexCount;
+        }
+    };
+
+    class ElementBufferObject : public BufferObject
+    {
+    private:
+        size_t m_IndexCount = 0;
+
+    public:
+        ElementBufferObject(const std::vector<unsigned int>& indices, BufferUsage _usage)
+            : BufferObject(_usage)
+        {
+            m_IndexCount = indices.size();
+            Allocate(indices.data(), indices.size() * sizeof(unsigned int));
+        }
+
+        ElementBufferObject()
+            : BufferObject(BufferUsage::Empty)
+        {
+        }
+
+        ElementBufferObject(ElementBufferObject&& other) noexcept
+            : BufferObject(std::move(other)), m_IndexCount(other.m_IndexCount)
+        {
+            other.m_IndexCount = 0;
+        }
+
+        ElementBufferObject& operator=(ElementBufferObject&& other) noexcept
+        {
+            if (this != &other)
+            {
+                BufferObject::operator=(std::move(other));
+                m_IndexCount = other.m_IndexCount;
+                other.m_IndexCount = 0;
+            }
+            return *this;
+        }
+
+        ElementBufferObject(const ElementBufferObject&) = delete;
+        ElementBufferObject& operator=(const ElementBufferObject&) = delete;
+
+        /// <summary>
+        /// Replaces all indices. Reallocates only when capacity is exceeded.
+        /// </summary>
+        void UpdateVBO(const std::vector<unsigned int>& indices)
+        {
+            Replace(indices.data(), indices.size() * sizeof(unsigned int));
+            m_IndexCount = indices.size();
+        }
+
+        /// <summary>
+        /// Uploads count indices starting at index first. Writing past end grows index count.
+        /// </summary>
+        void UpdateRange(size_t first, const unsigned int* indices, size_t count)
+        {
+            Write(first * sizeof(unsigned int), indices, count * sizeof(unsigned int));
+            m_IndexCount = std::max(m_IndexCount, first + count);
+        }
+
+        /// <summary>
+        /// Changes index count without uploading (kept indices stay on GPU).
+        /// </summary>
+        void SetIndexCount(size_t count)
+        {
+            SetSize(count * sizeof(unsigned int));
+            m_IndexCount = count;
+        }
+
+        void Use() const
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
+        }
+
+        void Unuse() const
+        {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+
+        size_t GetIndexCount() const
+        {
+            return m_IndexCount;
+        }
+    };
+
+    class VertexArrayObject
+    {
+    private:
+        unsigned int m_ID;
+
+        // Vertex array bound now, so objects drawn from same VAO (MeshPool) don't rebind it.
+        static inline unsigned int s_BoundID = 0;
+
+    public:
+        VertexArrayObject() : m_ID(0)
+        {
+            glGenVertexArrays(1, &m_ID);
+        }
+
+        ~VertexArrayObject()
+        {
+            Delete(m_ID);
+        }
+
+        VertexArrayObject(const VertexArrayObject&) = delete;
+        VertexArrayObject& operator=(const VertexArrayObject&) = delete;
+
+        VertexArrayObject(VertexArrayObject&& other) noexcept
+            : m_ID(other.m_ID)
+        {
+            other.m_ID = 0;
+        }
+
+        VertexArrayObject& operator=(VertexArrayObject&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Delete(m_ID);
+                m_ID = other.m_ID;
+                other.m_ID = 0;
+            }
+            return *this;
+        }
+
+        /// <summary>
+        /// Binds vertex array unless it is already bound. Use it instead of raw glBindVertexArray so binding cache stays right.
+        /// </summary>
+        static void Bind(unsigned int id)
+        {
+            if (s_BoundID == id)
+                return;
+
+            glBindVertexArray(id);
+            s_BoundID = id;
+        }
+
+        /// <summary>
+        /// Deleted vertex array is unbound by GL.
+        /// </summary>
+        static void Delete(unsigned int id)
+        {
+            if (id == 0)
+                return;
+
+            glDeleteVertexArrays(1, &id);
+            if (s_BoundID == id)
+                s_BoundID = 0;
+        }
+
+        /// <summary>
+        /// Call this if you called glBindVertexArray yourself, so next Use() binds again.
+        /// </summary>
+        static void InvalidateBinding()
+        {
+            s_BoundID = ~0u;
+        }
+
+        void LinkAttrib(VertexBufferObject* vbo, int index, int size, unsigned int type, bool normalized, int stride, const void* pointer)
+        {
+            Use();
+            vbo->Use();
+            glEnableVertexAttribArray(index);
+            glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+        }
+
+        void Use() const
+        {
+            Bind(m_ID);
+        }
+
+        void Unuse() const
+        {
+            Bind(0);
+        }
+    };
+
+    /// <summary>
+    /// <para>Ring buffer for geometry and uniforms rewritten every frame. Buffer is split into 3 regions (one per frame in flight),</para>
+    /// <para>persistently mapped with glBufferStorage (GL 4.4), fences make sure GPU finished reading region before it is reused.</para>
+    /// <para>Without GL 4.4 data is staged on CPU and sent with glBufferSubData.</para>
+    /// </summary>
+    class StreamBuffer
+    {
+    public:
+        struct Allocation
+        {
+            void* Data = nullptr;   // Write here (valid until EndFrame())
+            size_t Offset = 0;      // From start of buffer
+            size_t Size = 0;
+
+            bool IsValid() const
+            {
+                return Data != nullptr;
+            }
+        };
+
+    private:
+        static constexpr int RegionCount = 3;
+
+        unsigned int m_ID = 0;
+        unsigned char* m_Mapped = nullptr;
+        std::vector<unsigned char> m_Staging;
+        bool m_Persistent = false;
+
+        size_t m_RegionSize = 0;
+        int m_Region = 0;
+        size_t m_Used = 0;
+        size_t m_Flushed = 0;
+        bool m_OverflowLogged = false;
+
+        std::array<GLsync, RegionCount> m_Fences{};
+
+        unsigned int m_VAO = 0;
+
+    public:
+        /// <param name="bytesPerFrame">Most bytes allocated in one frame</param>
+        explicit StreamBuffer(size_t bytesPerFrame)
+            : m_RegionSize(bytesPerFrame)
+        {
+            size_t size = m_RegionSize * RegionCount;
+            m_Persistent = GLAD_GL_VERSION_4_4 != 0;
+
+            glGenBuffers(1, &m_ID);
+            glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+
+            if (m_Persistent)
+            {
+                unsigned int flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+                m_Mapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+            }
+
+            if (m_Mapped == nullptr)
+            {
+                // Storage of failed persistent buffer is immutable, start over with plain buffer.
+                if (m_Persistent)
+                {
+                    glDeleteBuffers(1, &m_ID);
+                    glGenBuffers(1, &m_ID);
+                    glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+                    m_Persistent = false;
+                }
 
-            fragment = glCreateShader(GL_FRAGMENT_SHADER);
-            glShaderSource(fragment, 1, &fShaderSource, nullptr);
-            CompileShader(fragment, ShaderType::Frag);
+                glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+                m_Staging.resize(size);
+                m_Mapped = m_Staging.data();
+            }
 
-            m_ID = glCreateProgram();
+            // Vertex layout for Draw()/DrawIndexed(), same as Renderable.
+            glGenVertexArrays(1, &m_VAO);
+            VertexArrayObject::Bind(m_VAO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aPos));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aColor));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aNormal));
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aUV));
+            VertexArrayObject::Bind(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
 
-            if (!geometryStringSource.empty())
+        ~StreamBuffer()
+        {
+            for (GLsync& fence : m_Fences)
             {
-                std::cout << "NOT EMPTY!\n";
-                geometry = glCreateShader(GL_GEOMETRY_SHADER);
-                glShaderSource(geometry, 1, &gShaderSource, nullptr);
-                CompileShader(geometry, ShaderType::Geom);
-                glAttachShader(m_ID, geometry);
+                if (fence != nullptr)
+                    glDeleteSync(fence);
             }
 
-            glAttachShader(m_ID, vertex);
-            glAttachShader(m_ID, fragment);
-
-            glLinkProgram(m_ID);
-
-            if (!geometryStringSource.empty())
+            if (m_Persistent)
             {
-                glDeleteShader(geometry);
+                glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
             }
 
-            glDeleteShader(vertex);
-            glDeleteShader(fragment);
+            VertexArrayObject::Delete(m_VAO);
+            glDeleteBuffers(1, &m_ID);
         }
 
-        ~Shader()
+        StreamBuffer(const StreamBuffer&) = delete;
+        StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+        /// <summary>
+        /// Reserves bytes in region of current frame.
+        /// </summary>
+        /// <param name="alignment">Offset is multiple of it (sizeof(Vertex) for vertices, GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniforms)</param>
+        /// <returns>Allocation, invalid if frame budget is used up</returns>
+        Allocation Allocate(size_t size, size_t alignment = sizeof(float))
         {
-            glDeleteProgram(m_ID);
+            size_t regionStart = m_Region * m_RegionSize;
+            size_t offset = (regionStart + m_Used + alignment - 1) / alignment * alignment;
+
+            if (offset + size > regionStart + m_RegionSize)
+            {
+                if (!m_OverflowLogged)
+                    Log("Warning! << StreamBuffer frame budget exceeded, increase bytesPerFrame.");
+                m_OverflowLogged = true;
+                return {};
+            }
+
+            m_Used = offset + size - regionStart;
+            return { m_Mapped + offset, offset, size };
         }
 
-        void Use()
+        /// <summary>
+        /// Allocates and copies data. Offset is aligned to sizeof(T), so Offset / sizeof(T) is element index.
+        /// </summary>
+        template<typename T>
+        Allocation Write(const T* data, size_t count)
         {
-            glUseProgram(m_ID);
+            Allocation allocation = Allocate(count * sizeof(T), sizeof(T));
+            if (allocation.IsValid())
+                std::memcpy(allocation.Data, data, count * sizeof(T));
+            return allocation;
         }
 
-        void Unuse()
+        template<typename T>
+        Allocation Write(const std::vector<T>& data)
         {
-            glUseProgram(0);
+            return Write(data.data(), data.size());
         }
 
         /// <summary>
-        /// Sets Matrix 4x4 to this shader.
+        /// Makes written data visible to GL. Called by Draw()/BindRange(), no-op with persistent mapping.
         /// </summary>
-        /// <param name="name">Name of matrix in shader</param>
-        /// <param name="count">Count</param>
-        /// <param name="transpose">is transpose?</param>
-        /// <param name="v">Value</param>
-        void SetMat4(const std::string& name, int count, bool transpose, const glm::mat4& v)
+        void Flush()
         {
-            Use();
-            glUniformMatrix4fv(GetUniformLocation(name), count, transpose, glm::value_ptr(v));
+            size_t regionStart = m_Region * m_RegionSize;
+            if (m_Persistent || m_Flushed >= m_Used)
+                return;
+
+            glBindBuffer(GL_ARRAY_BUFFER, m_ID);
+            glBufferSubData(GL_ARRAY_BUFFER, regionStart + m_Flushed, m_Used - m_Flushed, m_Staging.data() + regionStart + m_Flushed);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            m_Flushed = m_Used;
         }
 
         /// <summary>
-        /// Sets Vector4 to this shader.
+        /// Call once per frame after last draw using this buffer. Moves to next region, waits if GPU still reads it.
         /// </summary>
-        /// <param name="name">Name of vector in shader</param>
-        /// <param name="count">Count</param>
-        /// <param name="v">Value</param>
-        void SetVec4(const std::string& name, int count, const glm::vec4& v)
+        void EndFrame()
         {
-            Use();
-            glUniform4fv(GetUniformLocation(name), count, glm::value_ptr(v));
+            Flush();
+
+            if (m_Persistent)
+                m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+            m_Region = (m_Region + 1) % RegionCount;
+            m_Used = 0;
+            m_Flushed = 0;
+            m_OverflowLogged = false;
+
+            GLsync& fence = m_Fences[m_Region];
+            if (fence == nullptr)
+                return;
+
+            // Normally signaled long ago, waits only when CPU runs more than 2 frames ahead.
+            for (;;)
+            {
+                unsigned int result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+                    break;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
         }
 
         /// <summary>
-        /// Sets Vector3 to this shader.
+        /// Binds allocation to indexed target, e.g. GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER.
         /// </summary>
-        /// <param name="name">Name of vector in shader</param>
-        /// <param name="count">Count</param>
-        /// <param name="v">Value</param>
-        void SetVec3(const std::string& name, int count, const glm::vec3& v)
+        void BindRange(unsigned int target, unsigned int index, const Allocation& allocation)
         {
-            Use();
-            glUniform3fv(GetUniformLocation(name), count, glm::value_ptr(v));
+            Flush();
+            glBindBufferRange(target, index, m_ID, allocation.Offset, allocation.Size);
         }
 
         /// <summary>
-        /// Sets Vector2 to this shader.
+        /// Draws vertices written with Write(std::vector<Vertex>).
         /// </summary>
-        /// <param name="name">Name of vector in shader</param>
-        /// <param name="count">Count</param>
-        /// <param name="v">Value</param>
-        void SetVec2(const std::string& name, int count, const glm::vec2& v)
+        void Draw(RenderMode renderMode, const Allocation& vertices)
         {
-            Use();
-            glUniform2fv(GetUniformLocation(name), count, glm::value_ptr(v));
+            if (!vertices.IsValid())
+                return;
+
+            Flush();
+            VertexArrayObject::Bind(m_VAO);
+            glDrawArrays((int)renderMode, static_cast<int>(vertices.Offset / sizeof(Vertex)), static_cast<int>(vertices.Size / sizeof(Vertex)));
+            VertexArrayObject::Bind(0);
         }
 
         /// <summary>
-        /// Sets Float to this shader.
+        /// Draws vertices and unsigned int indices written with Write(). Indices are relative to first vertex of allocation.
         /// </summary>
-        /// <param name="name">Name of float in shader</param>
-        /// <param name="v">Value</param>
-        void SetFloat(const std::string& name, float v)
+        void DrawIndexed(RenderMode renderMode, const Allocation& vertices, const Allocation& indices)
         {
-            Use();
-            glUniform1f(GetUniformLocation(name), v);
+            if (!vertices.IsValid() || !indices.IsValid())
+                return;
+
+            Flush();
+            VertexArrayObject::Bind(m_VAO);
+            glDrawElementsBaseVertex((int)renderMode, static_cast<int>(indices.Size / sizeof(unsigned int)), GL_UNSIGNED_INT,
+                (const void*)indices.Offset, static_cast<int>(vertices.Offset / sizeof(Vertex)));
+            VertexArrayObject::Bind(0);
         }
 
-        /// <summary>
-        /// Sets Int to this shader.
-        /// </summary>
-        /// <param name="name">Name of int in shader</param>
-        /// <param name="v">Value</param>
-        void SetInt(const std::string& name, int v)
+        unsigned int GetID() const
         {
-            Use();
-            glUniform1i(GetUniformLocation(name), v);
+            return m_ID;
         }
+    };
 
-        /// <summary>
-        /// Sets Bool to this shader.
-        /// </summary>
-        /// <param name="name">Name of bool in shader</param>
-        /// <param name="v">Value</param>
-        void SetBool(const std::string& name, bool v)
+    /// <summary>
+    /// Sorted, non-overlapping [Begin, End) element ranges. Overlapping and touching ranges are merged on Add.
+    /// </summary>
+    class DirtyRanges
+    {
+    public:
+        struct Range
         {
-            Use();
-            glUniform1i(GetUniformLocation(name), v);
-        }
+            size_t Begin = 0;
+            size_t End = 0;
+        };
 
     private:
-        int GetUniformLocation(const std::string& name)
+        std::vector<Range> m_Ranges;
+
+    public:
+        void Add(size_t begin, size_t end)
         {
-            auto uniformIter = m_UniformLocations.find(name);
+            if (begin >= end)
+                return;
 
-            int location = 0;
+            auto first = std::lower_bound(m_Ranges.begin(), m_Ranges.end(), begin,
+                [](const Range& range, size_t value) { return range.End < value; });
 
-            if (uniformIter != m_UniformLocations.end())
-            {
-                location = uniformIter->second;
-            }
-            else
+            auto last = first;
+            while (last != m_Ranges.end() && last->Begin <= end)
             {
-                location = glGetUniformLocation(m_ID, name.c_str());
-                m_UniformLocations.insert({ name, location });
+                begin = std::min(begin, last->Begin);
+                end = std::max(end, last->End);
+                ++last;
             }
 
-            return location;
+            first = m_Ranges.erase(first, last);
+            m_Ranges.insert(first, { begin, end });
         }
 
-        static std::string GetShaderSource(const std::string& path)
+        /// <summary>
+        /// Drops everything at or past size (used when element count shrinks).
+        /// </summary>
+        void Clip(size_t size)
         {
-            std::string source;
-
-            std::ifstream file(path);
+            while (!m_Ranges.empty() && m_Ranges.back().Begin >= size)
+                m_Ranges.pop_back();
 
-            if (file.is_open())
-            {
-                std::stringstream sStr;
-                sStr << file.rdbuf();
-
-                source = sStr.str();
-
-                return source;
-            }
-            else
-            {
-                Log("Warning! << Failed to open file from path: " << path);
-                return "";
-            }
+            if (!m_Ranges.empty())
+                m_Ranges.back().End = std::min(m_Ranges.back().End, size);
         }
 
-        void CompileShader(unsigned int shader, ShaderType typeShader)
+        void Clear()
         {
-            glCompileShader(shader);
-
-            std::string shaderStringType =
-                (typeShader == ShaderType::Vert) ? "Vertex" :
-                (typeShader == ShaderType::Frag) ? "Fragment" :
-                (typeShader == ShaderType::Geom) ? "Geometry" :
-                "";
+            m_Ranges.clear();
+        }
 
-            int success;
+        bool IsEmpty() const
+        {
+            return m_Ranges.empty();
+        }
 
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if (!success)
-            {
-                char infoLog[1024];
-                glGetShaderInfoLog(shader, 1024, nullptr, infoLog);
-                Log("Warning! << Failed to compile " << shaderStringType << " shader.\nInfoLog: \n" << infoLog << '\n');
-            }
-            else
-            {
-                Log("Info! << Succesfully compiled " << shaderStringType << " shader.");
-            }
+        const std::vector<Range>& Get() const
+        {
+            return m_Ranges;
         }
     };
 
-    class Texture
+    /// <summary>
+    /// <para>First-fit allocator of [offset, offset + size) ranges inside one linear resource, it never touches memory itself.</para>
+    /// <para>Free blocks are kept sorted by offset and merged with neighbours on Free, so space does not fragment into slivers.</para>
+    /// </summary>
+    class FreeListAllocator
     {
-    private:
-        unsigned int m_ID = 0;
-        int m_Width = 0;
-        int m_Height = 0;
-        int m_Channels = 0;
-        TextureType m_Type{};
-
     public:
-        /// <param name="path">path to texture file.</param>
-        /// <param name="type">See TextureType struct.</param>
-        /// <param name="flipY">should flip texture vertically?</param>
-        Texture(const std::string& path, TextureType type, bool flipY, WrapMode wrapS, WrapMode wrapT, WrapMode wrapR, MinFilter minFilter, MagFilter magFilter)
-            : m_Type(type)
-        {
-            glGenTextures(1, &m_ID);
-            glBindTexture((unsigned int)m_Type, m_ID);
-
-            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_WRAP_S, (int)wrapS);
-            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_WRAP_T, (int)wrapT);
-            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_WRAP_R, (int)wrapR);
-            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_MIN_FILTER, (int)minFilter);
-            glTexParameteri((unsigned int)m_Type, GL_TEXTURE_MAG_FILTER, (int)magFilter);
+        static constexpr size_t InvalidOffset = SIZE_MAX;
 
-            stbi_set_flip_vertically_on_load(flipY);
+    private:
+        struct Block
+        {
+            size_t Offset = 0;
+            size_t Size = 0;
+        };
 
-            unsigned char* data = stbi_load(path.c_str(), &m_Width, &m_Height, &m_Channels, 0);
-            if (data)
-            {
-                unsigned int format = GL_RGB;
-                if (m_Channels == 1) format = GL_RED;
-                else if (m_Channels == 2) format = GL_RG;
-                else if (m_Channels == 3) format = GL_RGB;
-                else if (m_Channels == 4) format = GL_RGBA;
-                glTexImage2D((unsigned int)m_Type, 0, format, m_Width, m_Height, 0, format, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap((unsigned int)m_Type);
-            }
-            else
-            {
-                Log("Warning! << Failed to load texture from path: " << path);
-            }
-            stbi_image_free(data);
-        }
+        std::vector<Block> m_FreeBlocks;
+        size_t m_Capacity = 0;
+        size_t m_Used = 0;
 
-        ~Texture()
+    public:
+        explicit FreeListAllocator(size_t capacity = 0)
         {
-            glDeleteTextures(1, &m_ID);
+            Grow(capacity);
         }
 
-        Texture(Texture&& other) noexcept
-            : m_ID(other.m_ID)
+        /// <returns>Offset of allocated range, InvalidOffset when no free block is large enough</returns>
+        size_t Allocate(size_t size)
         {
-            other.m_ID = 0;
-        }
+            if (size == 0)
+                return InvalidOffset;
 
-        Texture& operator=(Texture&& other) noexcept
-        {
-            if (this != &other)
+            for (auto it = m_FreeBlocks.begin(); it != m_FreeBlocks.end(); ++it)
             {
-                glDeleteTextures(1, &m_ID);
-                m_ID = other.m_ID;
-                other.m_ID = 0;
-            }
-            return *this;
-        }
+                if (it->Size < size)
+                    continue;
 
-        Texture(const Texture&) = delete;
-        Texture& operator=(const Texture&) = delete;
+                size_t offset = it->Offset;
+                it->Offset += size;
+                it->Size -= size;
 
-        void Bind(unsigned int slot = 0) const
-        {
-            glActiveTexture(GL_TEXTURE0 + slot);
-            glBindTexture((unsigned int)m_Type, m_ID);
-        }
+                if (it->Size == 0)
+                    m_FreeBlocks.erase(it);
 
-        void Unbind() const
-        {
-            glBindTexture((unsigned int)m_Type, 0);
-        }
-    };
+                m_Used += size;
+                return offset;
+            }
 
-    class VertexBufferObject
-    {
-    private:
-        unsigned int m_ID;
+            return InvalidOffset;
+        }
 
-        BufferUsage m_Usage;
+        void Free(size_t offset, size_t size)
+        {
+            if (offset == InvalidOffset || size == 0)
+                return;
 
-        size_t m_Size = 0;
-        size_t m_VertexCount = 0;
+            m_Used -= size;
+            Insert(offset, size);
+        }
 
-    public:
-        VertexBufferObject(const std::vector<Vertex>& vertices, BufferUsage _usage) : m_ID(0)
+        /// <summary>
+        /// Adds [capacity, newCapacity) to free space, call it after growing underlying resource.
+        /// </summary>
+        void Grow(size_t newCapacity)
         {
-            glGenBuffers(1, &m_ID);
-
-            m_Usage = _usage;
-            m_Size = vertices.size() * sizeof(Vertex);
-            m_VertexCount = vertices.size();
+            if (newCapacity <= m_Capacity)
+                return;
 
-            glBindBuffer(GL_ARRAY_BUFFER, m_ID);
-            glBufferData(GL_ARRAY_BUFFER, m_Size, vertices.data(), (unsigned int)m_Usage);
+            Insert(m_Capacity, newCapacity - m_Capacity);
+            m_Capacity = newCapacity;
         }
 
-        VertexBufferObject() : m_ID(0)
+        size_t GetCapacity() const
         {
-            glGenBuffers(1, &m_ID);
-            m_Usage = BufferUsage::Empty;
-            m_Size = 0;
+            return m_Capacity;
         }
 
-        ~VertexBufferObject()
+        size_t GetUsed() const
         {
-            glDeleteBuffers(1, &m_ID);
+            return m_Used;
         }
 
-        VertexBufferObject(VertexBufferObject&& other) noexcept
-            : m_ID(other.m_ID), m_Usage(other.m_Usage)
+        size_t GetLargestFreeBlock() const
         {
-            other.m_ID = 0;
-            other.m_Usage = BufferUsage::Empty;
+            size_t largest = 0;
+            for (const Block& block : m_FreeBlocks)
+                largest = std::max(largest, block.Size);
+            return largest;
         }
 
-        VertexBufferObject& operator=(VertexBufferObject&& other) noexcept
+        size_t GetFreeBlockCount() const
         {
-            if (this != &other)
-            {
-                glDeleteBuffers(1, &m_ID);
-                m_VertexCount = other.m_VertexCount;
-                m_Usage = other.m_Usage;
-                m_ID = other.m_ID;
-                other.m_ID = 0;
-            }
-            return *this;
+            return m_FreeBlocks.size();
         }
 
-        VertexBufferObject(const VertexBufferObject&) = delete;
-        VertexBufferObject& operator=(const VertexBufferObject&) = delete;
-       
-        void UpdateVBO(const std::vector<Vertex>& vertices)
+    private:
+        void Insert(size_t offset, size_t size)
         {
-            Use();
-            size_t newSize = vertices.size() * sizeof(Vertex);
-            m_VertexCount = vertices.size();
+            auto next = std::lower_bound(m_FreeBlocks.begin(), m_FreeBlocks.end(), offset,
+                [](const Block& block, size_t value) { return block.Offset < value; });
 
-            if (newSize == m_Size)
+            bool mergePrevious = next != m_FreeBlocks.begin() && std::prev(next)->Offset + std::prev(next)->Size == offset;
+            bool mergeNext = next != m_FreeBlocks.end() && offset + size == next->Offset;
+
+            if (mergePrevious && mergeNext)
+            {
+                std::prev(next)->Size += size + next->Size;
+                m_FreeBlocks.erase(next);
+            }
+            else if (mergePrevious)
+            {
+                std::prev(next)->Size += size;
+            }
+            else if (mergeNext)
             {
-                glBufferSubData(GL_ARRAY_BUFFER, 0, newSize, vertices.data());
+                next->Offset = offset;
+                next->Size += size;
             }
             else
             {
-                glBufferData(GL_ARRAY_BUFFER, newSize, vertices.data(), (unsigned int)m_Usage);
-                m_Size = newSize;
+                m_FreeBlocks.insert(next, { offset, size });
             }
         }
+    };
 
-        void Use() const
+    /// <summary>
+    /// <para>Packs many meshes into one vertex buffer and one element buffer behind single VAO.</para>
+    /// <para>Mesh is just (BaseVertex, FirstIndex, IndexCount), so drawing different meshes needs no VAO or buffer switches:
+    /// call Use() once, then Draw() for each mesh. Buffers grow (keeping their names) when pool is full.</para>
+    /// </summary>
+    class MeshPool
+    {
+    public:
+        struct Mesh
         {
-            glBindBuffer(GL_ARRAY_BUFFER, m_ID);
-        }
+            size_t BaseVertex = FreeListAllocator::InvalidOffset;
+            size_t VertexCount = 0;
+            size_t FirstIndex = FreeListAllocator::InvalidOffset;
+            size_t IndexCount = 0;
 
-        void Unuse() const
+            bool IsValid() const
+            {
+                return IndexCount > 0;
+            }
+        };
+
+    private:
+        VertexArrayObject m_VAO;
+        VertexBufferObject m_VBO;
+        ElementBufferObject m_EBO;
+
+        FreeListAllocator m_VertexAllocator;
+        FreeListAllocator m_IndexAllocator;
+
+        size_t m_MeshCount = 0;
+
+    public:
+        /// <param name="vertexCapacity">Initial vertex count, pool grows when exceeded</param>
+        /// <param name="indexCapacity">Initial index count, pool grows when exceeded</param>
+        MeshPool(size_t vertexCapacity = 65536, size_t indexCapacity = 196608, BufferUsage usage = BufferUsage::StaticDraw)
+            : m_VBO({}, usage), m_EBO({}, usage)
         {
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            m_VBO.SetVertexCount(vertexCapacity);
+            m_EBO.SetIndexCount(indexCapacity);
+            m_VertexAllocator.Grow(vertexCapacity);
+            m_IndexAllocator.Grow(indexCapacity);
+
+            m_VAO.Use();
+            m_EBO.Use();
+            m_VAO.LinkAttrib(&m_VBO, 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aPos));
+            m_VAO.LinkAttrib(&m_VBO, 1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aColor));
+            m_VAO.LinkAttrib(&m_VBO, 2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aNormal));
+            m_VAO.LinkAttrib(&m_VBO, 3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aUV));
+            m_VAO.Unuse();
+            m_VBO.Unuse();
         }
 
-        size_t GetVertexCount() const
+        MeshPool(const MeshPool&) = delete;
+        MeshPool& operator=(const MeshPool&) = delete;
+
+        /// <summary>
+        /// Copies mesh into pool. Indices are relative to first vertex of this mesh, without indices vertices are drawn in order.
+        /// </summary>
+        Mesh Add(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
         {
-            return m_VertexCount;
-        }
-    };
+            Mesh mesh;
+            if (vertexCount == 0)
+                return mesh;
 
-    class ElementBufferObject
-    {
-    private:
-        unsigned int m_ID;
+            std::vector<unsigned int> sequential;
+            if (indexCount == 0)
+            {
+                sequential.resize(vertexCount);
+                std::iota(sequential.begin(), sequential.end(), 0u);
+                indices = sequential.data();
+                indexCount = sequential.size();
+            }
 
-        BufferUsage m_Usage;
+            mesh.BaseVertex = m_VertexAllocator.Allocate(vertexCount);
+            if (mesh.BaseVertex == FreeListAllocator::InvalidOffset)
+            {
+                GrowVertices(vertexCount);
+                mesh.BaseVertex = m_VertexAllocator.Allocate(vertexCount);
+            }
 
-        size_t m_Size = 0;
-        size_t m_IndexCount = 0;
+            mesh.FirstIndex = m_IndexAllocator.Allocate(indexCount);
+            if (mesh.FirstIndex == FreeListAllocator::InvalidOffset)
+            {
+                GrowIndices(indexCount);
+                mesh.FirstIndex = m_IndexAllocator.Allocate(indexCount);
+            }
 
-    public:
-        ElementBufferObject(const std::vector<unsigned int>& indices, BufferUsage _usage) : m_ID(0)
-        {
-            glGenBuffers(1, &m_ID);
+            mesh.VertexCount = vertexCount;
+            mesh.IndexCount = indexCount;
 
-            m_Usage = _usage;
-            m_Size = indices.size() * sizeof(unsigned int);
-            m_IndexCount = indices.size();
+            m_VBO.UpdateRange(mesh.BaseVertex, vertices, vertexCount);
+            m_EBO.UpdateRange(mesh.FirstIndex, indices, indexCount);
 
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_Size, indices.data(), (unsigned int)m_Usage);
+            ++m_MeshCount;
+            return mesh;
         }
 
-        ElementBufferObject() : m_ID(0)
+        Mesh Add(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices = {})
         {
-            glGenBuffers(1, &m_ID);
-            m_Usage = BufferUsage::Empty;
-            m_Size = 0;
+            return Add(vertices.data(), vertices.size(), indices.data(), indices.size());
         }
 
-        ~ElementBufferObject()
+        /// <summary>
+        /// Returns mesh space to pool and invalidates mesh.
+        /// </summary>
+        void Remove(Mesh& mesh)
         {
-            glDeleteBuffers(1, &m_ID);
-        }
+            if (!mesh.IsValid())
+                return;
 
-        ElementBufferObject(ElementBufferObject&& other) noexcept
-            : m_ID(other.m_ID), m_Usage(other.m_Usage)
-        {
-            other.m_ID = 0;
-            other.m_Usage = BufferUsage::Empty;
+            m_VertexAllocator.Free(mesh.BaseVertex, mesh.VertexCount);
+            m_IndexAllocator.Free(mesh.FirstIndex, mesh.IndexCount);
+            --m_MeshCount;
+
+            mesh = Mesh();
         }
 
-        ElementBufferObject& operator=(ElementBufferObject&& other) noexcept
+        /// <summary>
+        /// Overwrites count vertices starting at first (relative to mesh), mesh cannot grow this way.
+        /// </summary>
+        void UpdateVertices(const Mesh& mesh, size_t first, const Vertex* vertices, size_t count)
         {
-            if (this != &other)
+            if (!mesh.IsValid() || first + count > mesh.VertexCount)
             {
-                glDeleteBuffers(1, &m_ID);
-                m_IndexCount = other.m_IndexCount;
-                m_Usage = other.m_Usage;
-                m_ID = other.m_ID;
-                other.m_ID = 0;
+                Log("Warning! << Vertex update out of mesh range");
+                return;
             }
-            return *this;
-        }
 
-        ElementBufferObject(const ElementBufferObject&) = delete;
-        ElementBufferObject& operator=(const ElementBufferObject&) = delete;
+            m_VBO.UpdateRange(mesh.BaseVertex + first, vertices, count);
+        }
 
-        void UpdateVBO(const std::vector<unsigned int>& indices)
+        void UpdateIndices(const Mesh& mesh, size_t first, const unsigned int* indices, size_t count)
         {
-            Use();
-            size_t newSize = indices.size() * sizeof(unsigned int);
-            m_IndexCount = indices.size();
-
-            if (newSize == m_Size)
-            {
-                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, newSize, indices.data());
-            }
-            else
+            if (!mesh.IsValid() || first + count > mesh.IndexCount)
             {
-                glBufferData(GL_ELEMENT_ARRAY_BUFFER, newSize, indices.data(), (unsigned int)m_Usage);
-                m_Size = newSize;
+                Log("Warning! << Index update out of mesh range");
+                return;
             }
+
+            m_EBO.UpdateRange(mesh.FirstIndex + first, indices, count);
         }
 
         void Use() const
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ID);
+            m_VAO.Use();
         }
 
         void Unuse() const
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        }
-
-        size_t GetIndexCount() const
-        {
-            return m_IndexCount;
+            m_VAO.Unuse();
         }
-    };
-
-    class VertexArrayObject
-    {
-    private:
-        unsigned int m_ID;
 
-    public:
-        VertexArrayObject() : m_ID(0)
+        /// <summary>
+        /// Draws one mesh, pool has to be in use (Use()).
+        /// </summary>
+        void Draw(const Mesh& mesh, RenderMode renderMode) const
         {
-            glGenVertexArrays(1, &m_ID);
-        }
+            if (!mesh.IsValid())
+                return;
 
-        ~VertexArrayObject()
-        {
-            glDeleteVertexArrays(1, &m_ID);
+            glDrawElementsBaseVertex((int)renderMode, static_cast<int>(mesh.IndexCount), GL_UNSIGNED_INT,
+                (const void*)(mesh.FirstIndex * sizeof(unsigned int)), static_cast<int>(mesh.BaseVertex));
         }
 
-        VertexArrayObject(const VertexArrayObject&) = delete;
-        VertexArrayObject& operator=(const VertexArrayObject&) = delete;
-
-        VertexArrayObject(VertexArrayObject&& other) noexcept
-            : m_ID(other.m_ID)
+        size_t GetMeshCount() const
         {
-            other.m_ID = 0;
+            return m_MeshCount;
         }
 
-        VertexArrayObject& operator=(VertexArrayObject&& other) noexcept
+        const FreeListAllocator& GetVertexAllocator() const
         {
-            if (this != &other)
-            {
-                glDeleteVertexArrays(1, &m_ID);
-                m_ID = other.m_ID;
-                other.m_ID = 0;
-            }
-            return *this;
+            return m_VertexAllocator;
         }
 
-        void LinkAttrib(VertexBufferObject* vbo, int index, int size, unsigned int type, bool normalized, int stride, const void* pointer)
+        const FreeListAllocator& GetIndexAllocator() const
         {
-            Use();
-            vbo->Use();
-            glEnableVertexAttribArray(index);
-            glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+            return m_IndexAllocator;
         }
 
-        void Use() const
+    private:
+        void GrowVertices(size_t needed)
         {
-            glBindVertexArray(m_ID);
+            size_t capacity = std::max(m_VertexAllocator.GetCapacity() * 2, m_VertexAllocator.GetCapacity() + needed);
+            m_VBO.SetVertexCount(capacity);
+            m_VertexAllocator.Grow(capacity);
         }
 
-        void Unuse() const
+        void GrowIndices(size_t needed)
         {
-            glBindVertexArray(0);
+            size_t capacity = std::max(m_IndexAllocator.GetCapacity() * 2, m_IndexAllocator.GetCapacity() + needed);
+            m_EBO.SetIndexCount(capacity);
+            m_IndexAllocator.Grow(capacity);
         }
     };
 
@@ -1006,6 +5853,52 @@ namespace imcgkn
         std::vector<Vertex> m_Vertices;
         std::vector<unsigned int> m_Indices;
 
+        DirtyRanges m_DirtyVertices;
+        DirtyRanges m_DirtyIndices;
+
+        // CPU copy changed size since last Flush. GPU counts are resynced only then, so direct GetVBO()/GetEBO() updates stay intact.
+        bool m_VerticesResized = false;
+        bool m_IndicesResized = false;
+
+        // Set when geometry lives in shared MeshPool instead of own buffers
+        std::shared_ptr<MeshPool> m_Pool;
+        MeshPool::Mesh m_PoolMesh;
+
+        void FlushPooled()
+        {
+            // Any size change, including indices becoming empty (drawn in vertex order then), moves mesh to new range.
+            bool resized = m_VerticesResized || m_IndicesResized;
+
+            if (resized)
+            {
+                m_Pool->Remove(m_PoolMesh);
+                m_PoolMesh = m_Pool->Add(m_Vertices, m_Indices);
+            }
+            else
+            {
+                for (const DirtyRanges::Range& range : m_DirtyVertices.Get())
+                    m_Pool->UpdateVertices(m_PoolMesh, range.Begin, m_Vertices.data() + range.Begin, range.End - range.Begin);
+
+                for (const DirtyRanges::Range& range : m_DirtyIndices.Get())
+                    m_Pool->UpdateIndices(m_PoolMesh, range.Begin, m_Indices.data() + range.Begin, range.End - range.Begin);
+            }
+
+            m_DirtyVertices.Clear();
+            m_DirtyIndices.Clear();
+            m_VerticesResized = false;
+            m_IndicesResized = false;
+        }
+
+        void LinkVertexLayout()
+        {
+            m_VBO->Use();
+
+            m_VAO->LinkAttrib(m_VBO.get(), 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aPos));
+            m_VAO->LinkAttrib(m_VBO.get(), 1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aColor));
+            m_VAO->LinkAttrib(m_VBO.get(), 2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aNormal));
+            m_VAO->LinkAttrib(m_VBO.get(), 3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aUV));
+        }
+
     public:
         Renderable()
         {
@@ -1019,13 +5912,7 @@ namespace imcgkn
             m_VBO = std::make_unique<VertexBufferObject>(m_Vertices, vboUsage);
 
             m_VAO->Use();
-            m_VBO->Use();
-
-            m_VAO->LinkAttrib(m_VBO.get(), 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aPos));
-            m_VAO->LinkAttrib(m_VBO.get(), 1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aColor));
-            m_VAO->LinkAttrib(m_VBO.get(), 2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aNormal));
-            m_VAO->LinkAttrib(m_VBO.get(), 3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aUV));
-
+            LinkVertexLayout();
             m_VAO->Unuse();
         }
 
@@ -1043,34 +5930,61 @@ namespace imcgkn
                 m_EBO->Use();
             }
 
-            m_VBO->Use();
+            LinkVertexLayout();
+            m_VAO->Unuse();
+        }
 
-            m_VAO->LinkAttrib(m_VBO.get(), 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aPos));
-            m_VAO->LinkAttrib(m_VBO.get(), 1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aColor));
-            m_VAO->LinkAttrib(m_VBO.get(), 2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aNormal));
-            m_VAO->LinkAttrib(m_VBO.get(), 3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, aUV));
+        /// <summary>
+        /// Stores geometry in shared pool, renderable has no buffers or VAO of its own (GetVAO()/GetVBO() must not be used).
+        /// </summary>
+        Renderable(std::shared_ptr<MeshPool> pool, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices = {})
+            : m_Vertices(vertices), m_Indices(indices), m_Pool(std::move(pool))
+        {
+            m_PoolMesh = m_Pool->Add(m_Vertices, m_Indices);
+        }
 
-            m_VAO->Unuse();
+        ~Renderable()
+        {
+            if (m_Pool != nullptr)
+                m_Pool->Remove(m_PoolMesh);
         }
 
         Renderable(Renderable&& other) noexcept
             : m_VAO(std::move(other.m_VAO)),
               m_VBO(std::move(other.m_VBO)),
               m_EBO(std::move(other.m_EBO)),
-              m_Vertices(other.m_Vertices),
-              m_Indices(other.m_Indices)
+              m_Vertices(std::move(other.m_Vertices)),
+              m_Indices(std::move(other.m_Indices)),
+              m_DirtyVertices(std::move(other.m_DirtyVertices)),
+              m_DirtyIndices(std::move(other.m_DirtyIndices)),
+              m_VerticesResized(other.m_VerticesResized),
+              m_IndicesResized(other.m_IndicesResized),
+              m_Pool(std::move(other.m_Pool)),
+              m_PoolMesh(other.m_PoolMesh)
         {
+            other.m_PoolMesh = MeshPool::Mesh();
         }
 
         Renderable& operator=(Renderable&& other) noexcept
         {
             if (this != &other)
             {
+                if (m_Pool != nullptr)
+                    m_Pool->Remove(m_PoolMesh);
+
+                m_Pool = std::move(other.m_Pool);
+                m_PoolMesh = other.m_PoolMesh;
+                other.m_PoolMesh = MeshPool::Mesh();
+
                 m_VAO = std::move(other.m_VAO);
                 m_VBO = std::move(other.m_VBO);
                 m_EBO = std::move(other.m_EBO);
                 m_Vertices = std::move(other.m_Vertices);
                 m_Indices = std::move(other.m_Indices);
+                m_DirtyVertices = std::move(other.m_DirtyVertices);
+                m_DirtyIndices = std::move(other.m_DirtyIndices);
+                m_VerticesResized = other.m_VerticesResized;
+                m_IndicesResized = other.m_IndicesResized;
             }
             return *this;
         }
@@ -1078,11 +5992,173 @@ namespace imcgkn
         Renderable(const Renderable&) = delete;
         Renderable& operator=(const Renderable&) = delete;
 
+        /// <summary>
+        /// <para>Overwrites count vertices starting at first, writing past end grows mesh.</para>
+        /// <para>Only changed range is uploaded on next Flush, ranges touched several times in a frame are merged.</para>
+        /// </summary>
+        void UpdateVertices(size_t first, const Vertex* vertices, size_t count)
+        {
+            if (first + count > m_Vertices.size())
+            {
+                m_Vertices.resize(first + count);
+                m_VerticesResized = true;
+            }
+
+            std::copy(vertices, vertices + count, m_Vertices.begin() + first);
+            m_DirtyVertices.Add(first, first + count);
+        }
+
+        void UpdateVertices(size_t first, const std::vector<Vertex>& vertices)
+        {
+            UpdateVertices(first, vertices.data(), vertices.size());
+        }
+
+        /// <summary>
+        /// Overwrites count indices starting at first, writing past end grows index count.
+        /// </summary>
+        void UpdateIndices(size_t first, const unsigned int* indices, size_t count)
+        {
+            if (first + count > m_Indices.size())
+            {
+                m_Indices.resize(first + count);
+                m_IndicesResized = true;
+            }
+
+            std::copy(indices, indices + count, m_Indices.begin() + first);
+            m_DirtyIndices.Add(first, first + count);
+        }
+
+        void UpdateIndices(size_t first, const std::vector<unsigned int>& indices)
+        {
+            UpdateIndices(first, indices.data(), indices.size());
+        }
+
+        /// <summary>
+        /// Changes vertex count, new vertices are default initialized. Shrinking never reallocates on GPU.
+        /// </summary>
+        void ResizeVertices(size_t count)
+        {
+            size_t previous = m_Vertices.size();
+            m_Vertices.resize(count);
+            m_VerticesResized |= count != previous;
+
+            if (count < previous)
+                m_DirtyVertices.Clip(count);
+            else
+                m_DirtyVertices.Add(previous, count);
+        }
+
+        void ResizeIndices(size_t count)
+        {
+            size_t previous = m_Indices.size();
+            m_Indices.resize(count);
+            m_IndicesResized |= count != previous;
+
+            if (count < previous)
+                m_DirtyIndices.Clip(count);
+            else
+                m_DirtyIndices.Add(previous, count);
+        }
+
+        /// <summary>
+        /// Uploads dirty ranges with glBufferSubData. Buffers grow geometrically, so glBufferData runs only when capacity is exceeded.
+        /// </summary>
+        void Flush()
+        {
+            bool vertexCountChanged = m_VerticesResized;
+            bool indexCountChanged = m_IndicesResized;
+
+            if (m_DirtyVertices.IsEmpty() && m_DirtyIndices.IsEmpty() && !vertexCountChanged && !indexCountChanged)
+                return;
+
+            if (m_Pool != nullptr)
+            {
+                FlushPooled();
+                return;
+            }
+
+            if (m_VBO == nullptr && !m_Vertices.empty())
+            {
+                m_VBO = std::make_unique<VertexBufferObject>();
+                m_VBO->SetVertexCount(m_Vertices.size());
+
+                m_VAO->Use();
+                LinkVertexLayout();
+                m_VAO->Unuse();
+            }
+
+            if (m_EBO == nullptr && !m_Indices.empty())
+            {
+                m_EBO = std::make_unique<ElementBufferObject>();
+                m_EBO->SetIndexCount(m_Indices.size());
+
+                m_VAO->Use();
+                m_EBO->Use();
+                m_VAO->Unuse();
+            }
+
+            if (m_VBO != nullptr)
+            {
+                if (m_VerticesResized)
+                    m_VBO->SetVertexCount(m_Vertices.size());
+
+                for (const DirtyRanges::Range& range : m_DirtyVertices.Get())
+                    m_VBO->UpdateRange(range.Begin, m_Vertices.data() + range.Begin, range.End - range.Begin);
+            }
+
+            if (m_EBO != nullptr)
+            {
+                if (m_IndicesResized)
+                    m_EBO->SetIndexCount(m_Indices.size());
+
+                for (const DirtyRanges::Range& range : m_DirtyIndices.Get())
+                    m_EBO->UpdateRange(range.Begin, m_Indices.data() + range.Begin, range.End - range.Begin);
+            }
+
+            m_DirtyVertices.Clear();
+            m_DirtyIndices.Clear();
+            m_VerticesResized = false;
+            m_IndicesResized = false;
+        }
+
+        const std::vector<Vertex>& GetVertices() const
+        {
+            return m_Vertices;
+        }
+
+        const std::vector<unsigned int>& GetIndices() const
+        {
+            return m_Indices;
+        }
+
+        bool HasVBO() const
+        {
+            return m_VBO != nullptr;
+        }
+
+        bool IsPooled() const
+        {
+            return m_Pool != nullptr;
+        }
+
+        MeshPool* GetPool() const
+        {
+            return m_Pool.get();
+        }
+
+        const MeshPool::Mesh& GetPoolMesh() const
+        {
+            return m_PoolMesh;
+        }
+
         VertexArrayObject& GetVAO()
         {
             return *m_VAO.get();
         }
 
+        /// <summary>
+        /// Direct buffer updates (UpdateVBO) bypass CPU copy returned by GetVertices(), don't mix them with UpdateVertices on same mesh.
+        /// </summary>
         VertexBufferObject& GetVBO()
         {
             return *m_VBO.get();
@@ -1143,6 +6219,15 @@ namespace imcgkn
             m_Texture = std::make_shared<Texture>(std::forward<Args>(args)...);
         }
 
+        /// <summary>
+        /// Same as CreateTexture, but texture is shared through cache with other objects using same file and parameters.
+        /// </summary>
+        template<typename... Args>
+        void CreateTexture(TextureCache& cache, Args&& ...args)
+        {
+            m_Texture = cache.Get(std::forward<Args>(args)...);
+        }
+
         /// <param name="texture">Is of type shared_ptr!</param>
         void SetTexture(std::shared_ptr<Texture> texture)
         {
@@ -1150,12 +6235,12 @@ namespace imcgkn
         }
 
         /// <param name="shader">pointer to existing shader!</param>
-        /// <param name="modelName">Name of mat4 model parameter in your shader.</param>
+        /// <param name="modelName">Name of mat4 model parameter in your shader. (Prefer constexpr UniformID)</param>
         /// <param name="sampler2DName">Name of sampler2D in your shader. (Texture)</param>
         /// <param name="renderMode">See the struct RenderMode in this header file.</param>
-        void Render(Shader* shader, const std::string& modelName, const std::string& sampler2DName, RenderMode renderMode)
+        void Render(Shader* shader, UniformID modelName, UniformID sampler2DName, RenderMode renderMode)
         {
-            if (m_Renderable == nullptr || shader == nullptr)
+            if (m_Renderable == nullptr || shader == nullptr || !shader->IsReady())
                 return;
 
             shader->Use();
@@ -1176,9 +6261,22 @@ namespace imcgkn
                 shader->SetInt(sampler2DName, 0);
             }
 
+            m_Renderable->Flush();
+
+            if (m_Renderable->IsPooled())
+            {
+                // Pool VAO stays bound, next pooled object draws without any VAO change (Use() skips bound VAO).
+                m_Renderable->GetPool()->Use();
+                m_Renderable->GetPool()->Draw(m_Renderable->GetPoolMesh(), renderMode);
+                return;
+            }
+
+            if (!m_Renderable->HasVBO())
+                return;
+
             m_Renderable->GetVAO().Use();
 
-            if (m_Renderable->GetEBO()->GetIndexCount() > 0 && m_Renderable->GetEBO() != nullptr)
+            if (m_Renderable->GetEBO() != nullptr && m_Renderable->GetEBO()->GetIndexCount() > 0)
             {
                 glDrawElements((int)renderMode, m_Renderable->GetEBO()->GetIndexCount(), GL_UNSIGNED_INT, nullptr);
             }
@@ -1188,13 +6286,6 @@ namespace imcgkn
             }
 
             m_Renderable->GetVAO().Unuse();
-
-            if (m_Texture != nullptr)
-            {
-                m_Texture->Unbind();
-            }
-
-            shader->Unuse();
         }
     };
 
@@ -1202,12 +6293,13 @@ namespace imcgkn
     {
     private:
         glm::vec2 m_Position = glm::vec2();
+        glm::vec2 m_PreviousPosition = glm::vec2();
 
         float m_MoveSpeed = 0.0f;
 
     public:
         OrthoCamera(const glm::vec2& position, float moveSpeed = 50.0f)
-            : m_Position(position), m_MoveSpeed(moveSpeed)
+            : m_Position(position), m_PreviousPosition(position), m_MoveSpeed(moveSpeed)
         {
         }
 
@@ -1217,25 +6309,35 @@ namespace imcgkn
 
         void Update(Window& window)
         {
+            Update(window, window.GetDeltaTime());
+        }
+
+        /// <param name="deltaTime">Step to integrate with (e.g. FixedTimestep::GetStepTime())</param>
+        void Update(Window& window, float deltaTime)
+        {
+            m_PreviousPosition = m_Position;
+
             window.SetRelativeMouseMode(false);
             if (window.CheckKeyDown(SDL_SCANCODE_W))
-                m_Position.y += m_MoveSpeed * window.GetDeltaTime();
+                m_Position.y += m_MoveSpeed * deltaTime;
             if (window.CheckKeyDown(SDL_SCANCODE_S))
-                m_Position.y -= m_MoveSpeed * window.GetDeltaTime();
+                m_Position.y -= m_MoveSpeed * deltaTime;
             if (window.CheckKeyDown(SDL_SCANCODE_A))
-                m_Position.x -= m_MoveSpeed * window.GetDeltaTime();
+                m_Position.x -= m_MoveSpeed * deltaTime;
             if (window.CheckKeyDown(SDL_SCANCODE_D))
-                m_Position.x += m_MoveSpeed * window.GetDeltaTime();
+                m_Position.x += m_MoveSpeed * deltaTime;
         }
 
-        glm::mat4 GetProjectionViewMatrix(float windowWidth, float windowHeight, float near = -1.0f, float far = 1.0f) const
+        /// <param name="alpha">Interpolation between previous and current update (FixedTimestep::GetAlpha())</param>
+        glm::mat4 GetProjectionViewMatrix(float windowWidth, float windowHeight, float near = -1.0f, float far = 1.0f, float alpha = 1.0f) const
         {
+            glm::vec2 position = glm::mix(m_PreviousPosition, m_Position, alpha);
             float aspectRatio = windowWidth / windowHeight;
             float worldHeight = 10.0f;
             float worldWidth = worldHeight * aspectRatio;
             glm::mat4 proj = glm::mat4(1.0f);
             glm::mat4 view = glm::mat4(1.0f);
-            view = glm::translate(view, -glm::vec3(m_Position, 0.0f));
+            view = glm::translate(view, -glm::vec3(position, 0.0f));
             Log(worldWidth);
             Log(worldHeight);
             proj = glm::ortho(-worldWidth / 2.0f, worldWidth / 2.0f, -worldHeight / 2.0f, worldHeight / 2.0f, near, far);
@@ -1250,6 +6352,8 @@ namespace imcgkn
         glm::vec3 m_Front    = glm::vec3(0.0f, 0.0f,-1.0f);
         glm::vec3 m_Up       = glm::vec3(0.0f, 1.0f, 0.0f);
 
+        glm::vec3 m_PreviousPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+
         bool m_FirstMouse = true;
 
         float m_MoveSpeed = 0.0f;
@@ -1264,7 +6368,7 @@ namespace imcgkn
 
     public:
         PerspectiveCamera(const glm::vec3& position, float moveSpeed = 50.0f, float lookSpeed = 120.0f)
-            : m_Position(position), m_MoveSpeed(moveSpeed), m_LookSpeed(lookSpeed)
+            : m_Position(position), m_PreviousPosition(position), m_MoveSpeed(moveSpeed), m_LookSpeed(lookSpeed)
         {
 
         }
@@ -1275,14 +6379,18 @@ namespace imcgkn
 
         void Update(Window& window)
         {
-            window.SetRelativeMouseMode(true);
-            float deltaTime = window.GetDeltaTime();
-
-            float xoffset = 0.0f, yoffset = 0.0f;
-            window.GetRelMousePos(&xoffset, &yoffset);
+            Look(window);
+            Update(window, window.GetDeltaTime());
+        }
 
-            xoffset *= m_LookSpeed * deltaTime;
-            yoffset *= m_LookSpeed * deltaTime;
+        /// <summary>
+        /// <para>Moves camera with WASD, call it once per fixed step.</para>
+        /// <para>Mouse look is not applied here, call Look() once per frame so rotation doesn't depend on step count.</para>
+        /// </summary>
+        /// <param name="deltaTime">Step to integrate with (e.g. FixedTimestep::GetStepTime())</param>
+        void Update(Window& window, float deltaTime)
+        {
+            m_PreviousPosition = m_Position;
 
             if (window.CheckKeyDown(SDL_SCANCODE_W))
                 m_Position += m_Front * m_MoveSpeed * deltaTime;
@@ -1292,6 +6400,21 @@ namespace imcgkn
                 m_Position -= glm::normalize(glm::cross(m_Front, m_Up)) * m_MoveSpeed * deltaTime;
             if (window.CheckKeyDown(SDL_SCANCODE_D))
                 m_Position += glm::normalize(glm::cross(m_Front, m_Up)) * m_MoveSpeed * deltaTime;
+        }
+
+        /// <summary>
+        /// <para>Rotates camera by this frame's mouse movement. Call it once per frame, outside fixed-step loop.</para>
+        /// <para>Rotation is applied immediately (not interpolated), so view follows mouse without lag.</para>
+        /// </summary>
+        void Look(Window& window)
+        {
+            window.SetRelativeMouseMode(true);
+
+            float xoffset = 0.0f, yoffset = 0.0f;
+            window.GetRelMousePos(&xoffset, &yoffset);
+
+            xoffset *= m_LookSpeed * window.GetDeltaTime();
+            yoffset *= m_LookSpeed * window.GetDeltaTime();
 
             if (m_FirstMouse)
             {
@@ -1318,12 +6441,15 @@ namespace imcgkn
         /// <param name="fov">Field of view</param>
         /// <param name="near">near plane</param>
         /// <param name="far">far plane</param>
+        /// <param name="alpha">Interpolation between previous and current update (FixedTimestep::GetAlpha())</param>
         /// <returns>returns Perspective Matrix * View Matrix</returns>
-        glm::mat4 GetProjectionViewMatrix(int windowWidth, int windowHeight, float fov = 60.0f, float near = 0.01f, float far = 100.0f) const
+        glm::mat4 GetProjectionViewMatrix(int windowWidth, int windowHeight, float fov = 60.0f, float near = 0.01f, float far = 100.0f, float alpha = 1.0f) const
         {
+            glm::vec3 position = glm::mix(m_PreviousPosition, m_Position, alpha);
+
             glm::mat4 view = glm::mat4(1.0f);
             glm::mat4 proj = glm::mat4(1.0f);
-            view = glm::lookAt(m_Position, m_Position + m_Front, m_Up);
+            view = glm::lookAt(position, position + m_Front, m_Up);
             proj = glm::perspective(glm::radians(fov), static_cast<float>(windowWidth) / static_cast<float>(windowHeight), near, far);
             return proj * view;
         }
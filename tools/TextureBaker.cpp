@@ -0,0 +1,308 @@
+/*
+    TextureBaker - converts PNG/JPG/TGA... images into block-compressed, pre-mipped DDS files
+    that imcgknEngine.hpp Texture loads without decoding (glCompressedTexImage2D straight from mapped file).
+
+    Build with same include paths as your game (SDL2, GLAD, GLM, STB_IMAGE), nothing has to be linked:
+        g++ -std=c++17 -O2 -I<includes> tools/TextureBaker.cpp -o TextureBaker -pthread
+        cl /std:c++17 /O2 /EHsc /I<includes> tools\TextureBaker.cpp
+
+    Usage:
+        TextureBaker <input> <output.dds> [--bc1 | --bc3 | --bc5] [--flip] [--no-mips]
+
+        --bc1       RGB, 4 bits per texel (default)
+        --bc3       RGBA, 8 bits per texel
+        --bc5       Two channels (R, G), 8 bits per texel, for normal maps
+        --flip      Flip vertically, use it for textures you would load with flipY = true
+        --no-mips   Store only base level
+*/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../imcgknEngine.hpp"
+
+namespace
+{
+    using imcgkn::Image;
+
+    enum class BlockFormat
+    {
+        BC1,
+        BC3,
+        BC5
+    };
+
+    /// <summary>
+    /// Reads 4x4 block of RGBA texels, edge texels are repeated for images smaller than block.
+    /// </summary>
+    void FetchBlock(const Image& image, int blockX, int blockY, uint8_t texels[16][4])
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            for (int x = 0; x < 4; ++x)
+            {
+                int sourceX = std::min(blockX * 4 + x, image.Width - 1);
+                int sourceY = std::min(blockY * 4 + y, image.Height - 1);
+                const unsigned char* pixel = image.Pixels.data() + sourceY * image.GetRowSize() + sourceX * image.Channels;
+                uint8_t* texel = texels[y * 4 + x];
+
+                switch (image.Channels)
+                {
+                case 1: texel[0] = texel[1] = texel[2] = pixel[0]; texel[3] = 255; break;
+                case 2: texel[0] = texel[1] = texel[2] = pixel[0]; texel[3] = pixel[1]; break;
+                case 3: texel[0] = pixel[0]; texel[1] = pixel[1]; texel[2] = pixel[2]; texel[3] = 255; break;
+                default: std::memcpy(texel, pixel, 4); break;
+                }
+            }
+        }
+    }
+
+    uint16_t To565(const int color[3])
+    {
+        return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+    }
+
+    void From565(uint16_t packed, int color[3])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    /// <summary>
+    /// BC1 color block (4-color mode) with bounding box endpoints inset by 1/16 of range.
+    /// </summary>
+    void EncodeColorBlock(const uint8_t texels[16][4], uint8_t* out)
+    {
+        int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                low[c] = std::min<int>(low[c], texels[i][c]);
+                high[c] = std::max<int>(high[c], texels[i][c]);
+            }
+        }
+
+        for (int c = 0; c < 3; ++c)
+        {
+            int inset = (high[c] - low[c]) / 16;
+            low[c] += inset;
+            high[c] -= inset;
+        }
+
+        uint16_t color0 = To565(high), color1 = To565(low);
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        out[0] = color0 & 0xFF;
+        out[1] = color0 >> 8;
+        out[2] = color1 & 0xFF;
+        out[3] = color1 >> 8;
+
+        uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            int palette[4][3];
+            From565(color0, palette[0]);
+            From565(color1, palette[1]);
+            for (int c = 0; c < 3; ++c)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            for (int i = 0; i < 16; ++i)
+            {
+                int best = 0, bestError = INT32_MAX;
+                for (int p = 0; p < 4; ++p)
+                {
+                    int error = 0;
+                    for (int c = 0; c < 3; ++c)
+                        error += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+
+                    if (error < bestError)
+                    {
+                        best = p;
+                        bestError = error;
+                    }
+                }
+                indices |= static_cast<uint32_t>(best) << (i * 2);
+            }
+        }
+
+        for (int i = 0; i < 4; ++i)
+            out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+
+    /// <summary>
+    /// BC4 block of one channel (BC3 alpha, BC5 red and green), 8-value mode.
+    /// </summary>
+    void EncodeChannelBlock(const uint8_t texels[16][4], int channel, uint8_t* out)
+    {
+        int low = 255, high = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            low = std::min<int>(low, texels[i][channel]);
+            high = std::max<int>(high, texels[i][channel]);
+        }
+
+        out[0] = static_cast<uint8_t>(high);
+        out[1] = static_cast<uint8_t>(low);
+
+        uint64_t indices = 0;
+        if (high != low)
+        {
+            int palette[8] = { high, low };
+            for (int p = 1; p < 7; ++p)
+                palette[p + 1] = ((7 - p) * high + p * low) / 7;
+
+            for (int i = 0; i < 16; ++i)
+            {
+                int best = 0, bestError = INT32_MAX;
+                for (int p = 0; p < 8; ++p)
+                {
+                    int error = std::abs(texels[i][channel] - palette[p]);
+                    if (error < bestError)
+                    {
+                        best = p;
+                        bestError = error;
+                    }
+                }
+                indices |= static_cast<uint64_t>(best) << (i * 3);
+            }
+        }
+
+        for (int i = 0; i < 6; ++i)
+            out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+
+    std::vector<uint8_t> EncodeLevel(const Image& image, BlockFormat format)
+    {
+        int blocksX = (image.Width + 3) / 4, blocksY = (image.Height + 3) / 4;
+        size_t blockSize = format == BlockFormat::BC1 ? 8 : 16;
+
+        std::vector<uint8_t> encoded(static_cast<size_t>(blocksX) * blocksY * blockSize);
+        uint8_t texels[16][4];
+
+        for (int blockY = 0; blockY < blocksY; ++blockY)
+        {
+            for (int blockX = 0; blockX < blocksX; ++blockX)
+            {
+                FetchBlock(image, blockX, blockY, texels);
+                uint8_t* out = encoded.data() + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+
+                switch (format)
+                {
+                case BlockFormat::BC1:
+                    EncodeColorBlock(texels, out);
+                    break;
+                case BlockFormat::BC3:
+                    EncodeChannelBlock(texels, 3, out);
+                    EncodeColorBlock(texels, out + 8);
+                    break;
+                case BlockFormat::BC5:
+                    EncodeChannelBlock(texels, 0, out);
+                    EncodeChannelBlock(texels, 1, out + 8);
+                    break;
+                }
+            }
+        }
+
+        return encoded;
+    }
+
+    bool WriteDDS(const std::string& path, const Image& base, BlockFormat format, const std::vector<std::vector<uint8_t>>& levels)
+    {
+        uint32_t header[32] = {};
+        header[0] = 0x20534444;                                         // "DDS "
+        header[1] = 124;                                                // Header size
+        header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000;                 // CAPS | HEIGHT | WIDTH | PIXELFORMAT | LINEARSIZE
+        header[3] = static_cast<uint32_t>(base.Height);
+        header[4] = static_cast<uint32_t>(base.Width);
+        header[5] = static_cast<uint32_t>(levels[0].size());
+        header[7] = static_cast<uint32_t>(levels.size());
+        header[19] = 32;                                                // Pixel format size
+        header[20] = 0x4;                                               // DDPF_FOURCC
+        header[21] = format == BlockFormat::BC1 ? 0x31545844 : format == BlockFormat::BC3 ? 0x35545844 : 0x32495441;    // DXT1, DXT5, ATI2
+        header[27] = 0x1000;                                            // DDSCAPS_TEXTURE
+
+        if (levels.size() > 1)
+        {
+            header[2] |= 0x20000;                                       // MIPMAPCOUNT
+            header[27] |= 0x8 | 0x400000;                               // COMPLEX | MIPMAP
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        for (const std::vector<uint8_t>& level : levels)
+            file.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+
+        return static_cast<bool>(file);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: TextureBaker <input> <output.dds> [--bc1 | --bc3 | --bc5] [--flip] [--no-mips]\n";
+        return 1;
+    }
+
+    std::string input = argv[1], output = argv[2];
+    BlockFormat format = BlockFormat::BC1;
+    bool flip = false, mips = true;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (option == "--bc1") format = BlockFormat::BC1;
+        else if (option == "--bc3") format = BlockFormat::BC3;
+        else if (option == "--bc5") format = BlockFormat::BC5;
+        else if (option == "--flip") flip = true;
+        else if (option == "--no-mips") mips = false;
+        else
+        {
+            std::cerr << "Unknown option: " << option << '\n';
+            return 1;
+        }
+    }
+
+    Image image = Image::Load(input, flip);
+    if (!image.IsValid())
+    {
+        std::cerr << "Failed to load image: " << input << '\n';
+        return 1;
+    }
+
+    int levelCount = 1;
+    if (mips)
+    {
+        for (int size = std::max(image.Width, image.Height); size > 1; size /= 2)
+            ++levelCount;
+    }
+
+    std::vector<Image> chain = Image::GenerateMipChain(image, levelCount);
+
+    std::vector<std::vector<uint8_t>> levels;
+    levels.push_back(EncodeLevel(image, format));
+    for (const Image& mip : chain)
+        levels.push_back(EncodeLevel(mip, format));
+
+    if (!WriteDDS(output, image, format, levels))
+    {
+        std::cerr << "Failed to write: " << output << '\n';
+        return 1;
+    }
+
+    size_t bytes = 0;
+    for (const std::vector<uint8_t>& level : levels)
+        bytes += level.size();
+
+    std::cout << output << ": " << image.Width << "x" << image.Height << ", " << levels.size() << " levels, "
+        << bytes << " bytes (uncompressed " << image.Pixels.size() << ")\n";
+    return 0;
+}